@@ -0,0 +1,146 @@
+#include "array_kernels.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define LOX_X86_KERNELS
+#endif
+
+using lox::ArrayOp;
+
+namespace {
+
+// each operation in scalar and, on x86-64, 2- and 4-wide vector forms
+struct Add {
+  static double apply(double a, double b) { return a + b; }
+#ifdef LOX_X86_KERNELS
+  static __m128d apply(__m128d a, __m128d b) { return _mm_add_pd(a, b); }
+  [[gnu::target("avx2")]] static __m256d apply(__m256d a, __m256d b) {
+    return _mm256_add_pd(a, b);
+  }
+#endif
+};
+
+struct Subtract {
+  static double apply(double a, double b) { return a - b; }
+#ifdef LOX_X86_KERNELS
+  static __m128d apply(__m128d a, __m128d b) { return _mm_sub_pd(a, b); }
+  [[gnu::target("avx2")]] static __m256d apply(__m256d a, __m256d b) {
+    return _mm256_sub_pd(a, b);
+  }
+#endif
+};
+
+struct Multiply {
+  static double apply(double a, double b) { return a * b; }
+#ifdef LOX_X86_KERNELS
+  static __m128d apply(__m128d a, __m128d b) { return _mm_mul_pd(a, b); }
+  [[gnu::target("avx2")]] static __m256d apply(__m256d a, __m256d b) {
+    return _mm256_mul_pd(a, b);
+  }
+#endif
+};
+
+struct Divide {
+  static double apply(double a, double b) { return a / b; }
+#ifdef LOX_X86_KERNELS
+  static __m128d apply(__m128d a, __m128d b) { return _mm_div_pd(a, b); }
+  [[gnu::target("avx2")]] static __m256d apply(__m256d a, __m256d b) {
+    return _mm256_div_pd(a, b);
+  }
+#endif
+};
+
+using Kernel = void (*)(const double *lhs, const double *rhs, double *out,
+                        std::size_t count);
+
+// elements [start, count); also finishes off what the vector kernels leave
+template <typename Op, bool LHS_SCALAR, bool RHS_SCALAR>
+void scalarLoop(const double *lhs, const double *rhs, double *out,
+                std::size_t start, std::size_t count) {
+  for (auto i = start; i < count; i++) {
+    out[i] = Op::apply(LHS_SCALAR ? lhs[0] : lhs[i],
+                       RHS_SCALAR ? rhs[0] : rhs[i]);
+  }
+}
+
+template <typename Op, bool LHS_SCALAR, bool RHS_SCALAR>
+void scalarKernel(const double *lhs, const double *rhs, double *out,
+                  std::size_t count) {
+  scalarLoop<Op, LHS_SCALAR, RHS_SCALAR>(lhs, rhs, out, 0, count);
+}
+
+#ifdef LOX_X86_KERNELS
+// SSE2 is part of x86-64, so this needs no runtime check
+template <typename Op, bool LHS_SCALAR, bool RHS_SCALAR>
+void sse2Kernel(const double *lhs, const double *rhs, double *out,
+                std::size_t count) {
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    auto a = LHS_SCALAR ? _mm_set1_pd(lhs[0]) : _mm_loadu_pd(lhs + i);
+    auto b = RHS_SCALAR ? _mm_set1_pd(rhs[0]) : _mm_loadu_pd(rhs + i);
+    _mm_storeu_pd(out + i, Op::apply(a, b));
+  }
+  scalarLoop<Op, LHS_SCALAR, RHS_SCALAR>(lhs, rhs, out, i, count);
+}
+
+template <typename Op, bool LHS_SCALAR, bool RHS_SCALAR>
+[[gnu::target("avx2")]] void avx2Kernel(const double *lhs, const double *rhs,
+                                        double *out, std::size_t count) {
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    auto a = LHS_SCALAR ? _mm256_set1_pd(lhs[0]) : _mm256_loadu_pd(lhs + i);
+    auto b = RHS_SCALAR ? _mm256_set1_pd(rhs[0]) : _mm256_loadu_pd(rhs + i);
+    _mm256_storeu_pd(out + i, Op::apply(a, b));
+  }
+  scalarLoop<Op, LHS_SCALAR, RHS_SCALAR>(lhs, rhs, out, i, count);
+}
+
+bool hasAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+
+template <typename Op, bool LHS_SCALAR, bool RHS_SCALAR> Kernel selectKernel() {
+#ifdef LOX_X86_KERNELS
+  if (hasAvx2()) {
+    return avx2Kernel<Op, LHS_SCALAR, RHS_SCALAR>;
+  }
+  return sse2Kernel<Op, LHS_SCALAR, RHS_SCALAR>;
+#else
+  return scalarKernel<Op, LHS_SCALAR, RHS_SCALAR>;
+#endif
+}
+
+template <typename Op>
+void applyWith(const double *lhs, bool lhsIsScalar, const double *rhs,
+               bool rhsIsScalar, double *out, std::size_t count) {
+  if (lhsIsScalar) {
+    selectKernel<Op, true, false>()(lhs, rhs, out, count);
+  } else if (rhsIsScalar) {
+    selectKernel<Op, false, true>()(lhs, rhs, out, count);
+  } else {
+    selectKernel<Op, false, false>()(lhs, rhs, out, count);
+  }
+}
+
+} // namespace
+
+void lox::applyArrayOp(ArrayOp op, const double *lhs, bool lhsIsScalar,
+                       const double *rhs, bool rhsIsScalar, double *out,
+                       std::size_t count) {
+  switch (op) {
+  case ArrayOp::ADD:
+    applyWith<Add>(lhs, lhsIsScalar, rhs, rhsIsScalar, out, count);
+    break;
+  case ArrayOp::SUBTRACT:
+    applyWith<Subtract>(lhs, lhsIsScalar, rhs, rhsIsScalar, out, count);
+    break;
+  case ArrayOp::MULTIPLY:
+    applyWith<Multiply>(lhs, lhsIsScalar, rhs, rhsIsScalar, out, count);
+    break;
+  case ArrayOp::DIVIDE:
+    applyWith<Divide>(lhs, lhsIsScalar, rhs, rhsIsScalar, out, count);
+    break;
+  }
+}
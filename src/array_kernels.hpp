@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lox {
+
+enum class ArrayOp : uint8_t { ADD, SUBTRACT, MULTIPLY, DIVIDE };
+
+// out[i] = lhs[i] op rhs[i] for every i below count. Either operand (but not
+// both) can be a scalar instead, read from lhs[0] or rhs[0] and broadcast to
+// every element.
+// Runs AVX2 kernels when the CPU has them, SSE2 on other x86-64 CPUs, and a
+// plain loop elsewhere; every path rounds identically, so results don't
+// depend on the machine.
+void applyArrayOp(ArrayOp op, const double *lhs, bool lhsIsScalar,
+                  const double *rhs, bool rhsIsScalar, double *out,
+                  std::size_t count);
+
+} // namespace lox
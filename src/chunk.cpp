@@ -1,13 +1,62 @@
 #include "chunk.hpp"
 #include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 using lox::Chunk;
+using lox::OpCode;
+
+std::optional<lox::OpCodeInfo> OpCode::info(uint8_t byte) {
+  switch (byte) {
+  case OP_CONSTANT:
+    return OpCodeInfo{1, 0, 1};
+  case OP_RETURN:
+    return OpCodeInfo{0, 0, 0};
+  case OP_NEGATE:
+    return OpCodeInfo{0, 1, 1};
+  case OP_ADD:
+  case OP_SUBTRACT:
+  case OP_MULTIPLY:
+  case OP_DIVIDE:
+    return OpCodeInfo{0, 2, 1};
+  case OP_NIL:
+    return OpCodeInfo{0, 0, 1};
+  case OP_POP:
+  case OP_PRINT:
+    return OpCodeInfo{0, 1, 0};
+  case OP_DEFINE_GLOBAL:
+    return OpCodeInfo{1, 1, 0};
+  case OP_GET_GLOBAL:
+    return OpCodeInfo{1, 0, 1};
+  case OP_SET_GLOBAL:
+    // assignment is an expression; the assigned value stays on the stack
+    return OpCodeInfo{1, 1, 1};
+  case OP_BUILD_ARRAY:
+    return OpCodeInfo{1, 0, 1};
+  case OP_NUMBER:
+    return OpCodeInfo{1, 0, 0, 0, 1};
+  case OP_NEGATE_F64:
+    return OpCodeInfo{0, 0, 0, 1, 1};
+  case OP_ADD_F64:
+  case OP_SUBTRACT_F64:
+  case OP_MULTIPLY_F64:
+  case OP_DIVIDE_F64:
+    return OpCodeInfo{0, 0, 0, 2, 1};
+  case OP_BOX:
+    return OpCodeInfo{0, 0, 1, 1, 0};
+  case OP_BOX_UNDER:
+    // takes the Value on top off and puts it back above the boxed number
+    return OpCodeInfo{0, 1, 2, 1, 0};
+  default:
+    return std::nullopt;
+  }
+}
 
 void Chunk::write(uint8_t byte, int lineNumber) {
   code.push_back(byte);
   lineNumbers.push_back(lineNumber);
+  verifiedGlobalCount.reset();
 }
 
 // returns the index of the added constant, so we can look it up later
@@ -17,6 +66,96 @@ int Chunk::addConstant(Value constant) {
   return constantPool.size() - 1;
 }
 
+int Chunk::addNumberConstant(double constant) {
+  numberConstants.push_back(constant);
+  return numberConstants.size() - 1;
+}
+
+// Single pass over the code. There are no jumps yet, so walking instructions
+// in order visits every path, and the running stack depth is exact.
+std::optional<std::string> Chunk::verify(std::size_t globalCount) {
+  auto describe = [](std::size_t offset, const std::string &problem) {
+    std::ostringstream message;
+    message << "offset " << std::setfill('0') << std::setw(4) << offset << ": "
+            << problem;
+    return message.str();
+  };
+
+  if (lineNumbers.size() != code.size()) {
+    return describe(0, "line number table doesn't match code");
+  }
+
+  std::size_t offset = 0;
+  std::size_t lastOpcodeOffset = 0;
+  int stackDepth = 0;
+  int numberStackDepth = 0;
+  while (offset < code.size()) {
+    auto opcode = code[offset];
+    auto info = OpCode::info(opcode);
+    if (!info) {
+      return describe(offset, "unknown opcode " + std::to_string(opcode));
+    }
+
+    if (offset + info->operandBytes >= code.size()) {
+      return describe(offset, "operand runs past end of code");
+    }
+
+    if (opcode == OpCode::OP_CONSTANT &&
+        code[offset + 1] >= constantPool.size()) {
+      return describe(offset, "constant index " +
+                                  std::to_string(code[offset + 1]) +
+                                  " out of range");
+    }
+
+    if (opcode == OpCode::OP_NUMBER &&
+        code[offset + 1] >= numberConstants.size()) {
+      return describe(offset, "number constant index " +
+                                  std::to_string(code[offset + 1]) +
+                                  " out of range");
+    }
+
+    if ((opcode == OpCode::OP_DEFINE_GLOBAL ||
+         opcode == OpCode::OP_GET_GLOBAL || opcode == OpCode::OP_SET_GLOBAL) &&
+        code[offset + 1] >= globalCount) {
+      return describe(offset, "global slot " +
+                                  std::to_string(code[offset + 1]) +
+                                  " out of range");
+    }
+
+    auto pops = info->pops;
+    if (opcode == OpCode::OP_BUILD_ARRAY) {
+      pops += code[offset + 1];
+    }
+
+    if (stackDepth < pops) {
+      return describe(offset, "stack underflow");
+    }
+    stackDepth += info->pushes - pops;
+    if (stackDepth > maxStackDepth) {
+      return describe(offset, "stack grows past declared maximum depth");
+    }
+
+    if (numberStackDepth < info->numberPops) {
+      return describe(offset, "number stack underflow");
+    }
+    numberStackDepth += info->numberPushes - info->numberPops;
+    if (numberStackDepth > maxNumberStackDepth) {
+      return describe(offset,
+                      "number stack grows past declared maximum depth");
+    }
+
+    lastOpcodeOffset = offset;
+    offset += 1 + info->operandBytes;
+  }
+
+  if (code.empty() || code[lastOpcodeOffset] != OpCode::OP_RETURN) {
+    return describe(lastOpcodeOffset, "code doesn't end in OP_RETURN");
+  }
+
+  verifiedGlobalCount = globalCount;
+  return std::nullopt;
+}
+
 void Chunk::disassemble(const std::string &chunkName) {
   std::cout << "== " << chunkName << " =="
             << "\n";
@@ -28,60 +167,112 @@ void Chunk::disassemble(const std::string &chunkName) {
   }
 }
 
-int Chunk::disassembleInstruction(int offset) {
-  std::ios_base::fmtflags f(std::cout.flags());
+int Chunk::disassembleInstruction(int offset, std::ostream &out) {
+  std::ios_base::fmtflags f(out.flags());
 
   // byte offset of the instruction within the chunk
-  std::cout << std::setfill('0') << std::setw(4) << offset << " ";
-  std::cout.flags(f);
+  out << std::setfill('0') << std::setw(4) << offset << " ";
+  out.flags(f);
 
   // source line number that instruction came from
   if (offset > 0 &&
       // if same line # as previous instruction
       lineNumbers.at(offset) == lineNumbers.at(offset - 1)) {
-    std::cout << "   | ";
+    out << "   | ";
   } else {
-    std::cout << std::setw(4) << lineNumbers.at(offset) << " ";
+    out << std::setw(4) << lineNumbers.at(offset) << " ";
   }
-  std::cout.flags(f);
+  out.flags(f);
 
   auto instruction = this->code.at(offset);
   switch (instruction) {
   case OpCode::OP_CONSTANT:
-    return disassembleConstantInstruction("OP_CONSTANT", offset);
+    return disassembleConstantInstruction("OP_CONSTANT", offset, out);
   case OpCode::OP_RETURN:
-    return disassembleSimpleInstruction("OP_RETURN", offset);
+    return disassembleSimpleInstruction("OP_RETURN", offset, out);
   case OpCode::OP_NEGATE:
-    return disassembleSimpleInstruction("OP_NEGATE", offset);
+    return disassembleSimpleInstruction("OP_NEGATE", offset, out);
   case OpCode::OP_ADD:
-    return disassembleSimpleInstruction("OP_ADD", offset);
+    return disassembleSimpleInstruction("OP_ADD", offset, out);
   case OpCode::OP_SUBTRACT:
-    return disassembleSimpleInstruction("OP_SUBTRACT", offset);
+    return disassembleSimpleInstruction("OP_SUBTRACT", offset, out);
   case OpCode::OP_MULTIPLY:
-    return disassembleSimpleInstruction("OP_MULTIPLY", offset);
+    return disassembleSimpleInstruction("OP_MULTIPLY", offset, out);
   case OpCode::OP_DIVIDE:
-    return disassembleSimpleInstruction("OP_DIVIDE", offset);
+    return disassembleSimpleInstruction("OP_DIVIDE", offset, out);
+  case OpCode::OP_NIL:
+    return disassembleSimpleInstruction("OP_NIL", offset, out);
+  case OpCode::OP_POP:
+    return disassembleSimpleInstruction("OP_POP", offset, out);
+  case OpCode::OP_PRINT:
+    return disassembleSimpleInstruction("OP_PRINT", offset, out);
+  case OpCode::OP_DEFINE_GLOBAL:
+    return disassembleByteInstruction("OP_DEFINE_GLOBAL", offset, out);
+  case OpCode::OP_GET_GLOBAL:
+    return disassembleByteInstruction("OP_GET_GLOBAL", offset, out);
+  case OpCode::OP_SET_GLOBAL:
+    return disassembleByteInstruction("OP_SET_GLOBAL", offset, out);
+  case OpCode::OP_BUILD_ARRAY:
+    return disassembleByteInstruction("OP_BUILD_ARRAY", offset, out, "count");
+  case OpCode::OP_NUMBER:
+    return disassembleNumberInstruction("OP_NUMBER", offset, out);
+  case OpCode::OP_NEGATE_F64:
+    return disassembleSimpleInstruction("OP_NEGATE_F64", offset, out);
+  case OpCode::OP_ADD_F64:
+    return disassembleSimpleInstruction("OP_ADD_F64", offset, out);
+  case OpCode::OP_SUBTRACT_F64:
+    return disassembleSimpleInstruction("OP_SUBTRACT_F64", offset, out);
+  case OpCode::OP_MULTIPLY_F64:
+    return disassembleSimpleInstruction("OP_MULTIPLY_F64", offset, out);
+  case OpCode::OP_DIVIDE_F64:
+    return disassembleSimpleInstruction("OP_DIVIDE_F64", offset, out);
+  case OpCode::OP_BOX:
+    return disassembleSimpleInstruction("OP_BOX", offset, out);
+  case OpCode::OP_BOX_UNDER:
+    return disassembleSimpleInstruction("OP_BOX_UNDER", offset, out);
   default:
-    std::cout << "Unknown opcode " << instruction << "\n";
+    out << "Unknown opcode " << instruction << "\n";
     return offset + 1;
   }
 }
 
 // for disassembling zero-operand (one-byte) simple instructions
-int Chunk::disassembleSimpleInstruction(const std::string &name, int offset) {
-  std::cout << name << "\n";
+int Chunk::disassembleSimpleInstruction(const std::string &name, int offset,
+                                        std::ostream &out) {
+  out << name << "\n";
   return offset + 1;
 }
 
 // for disassembling one-operand (two-byte) constant instructions
-int Chunk::disassembleConstantInstruction(const std::string &name, int offset) {
+int Chunk::disassembleConstantInstruction(const std::string &name,
+                                          int offset, std::ostream &out) {
   auto constantIndex = code.at(offset + 1);
-  std::cout << name << "@ "
-            << static_cast<int>(
-                   constantIndex) // static_cast is necessary to avoid treating
-                                  // constantIndex like an ASCII char
-            << " value: ";
-  printValue(constantPool.at(constantIndex));
-  std::cout << "\n";
+  out << name << "@ "
+      << static_cast<int>(
+             constantIndex) // static_cast is necessary to avoid treating
+                            // constantIndex like an ASCII char
+      << " value: ";
+  printValue(constantPool.at(constantIndex), out);
+  out << "\n";
   return offset + 2;
-}
\ No newline at end of file
+}
+
+// like a constant instruction, but indexing the unboxed number constants
+int Chunk::disassembleNumberInstruction(const std::string &name, int offset,
+                                        std::ostream &out) {
+  auto constantIndex = code.at(offset + 1);
+  out << name << "@ " << static_cast<int>(constantIndex)
+      << " value: " << numberConstants.at(constantIndex) << "\n";
+  return offset + 2;
+}
+
+// for disassembling instructions with a one-byte operand other than a
+// constant index
+int Chunk::disassembleByteInstruction(const std::string &name, int offset,
+                                      std::ostream &out,
+                                      const std::string &operandName) {
+  auto operand = code.at(offset + 1);
+  out << name << " " << operandName << " " << static_cast<int>(operand)
+      << "\n";
+  return offset + 2;
+}
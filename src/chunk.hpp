@@ -1,12 +1,29 @@
 #pragma once
 
 #include "value.hpp"
+#include <cstddef>
 #include <cstdint>
+#include <iostream>
+#include <optional>
 #include <string>
 #include <vector>
 
 namespace lox {
 
+// most values any chunk may need on the stack at once
+constexpr int STACK_MAX = 256;
+
+// static shape of an instruction: how many operand bytes follow the opcode,
+// and how many values it pops off / pushes onto the stack and the unboxed
+// number stack; OP_BUILD_ARRAY also pops as many elements as its operand says
+struct OpCodeInfo {
+  int operandBytes;
+  int pops;
+  int pushes;
+  int numberPops{0};
+  int numberPushes{0};
+};
+
 class OpCode {
 public:
   static constexpr uint8_t OP_CONSTANT = 0;
@@ -16,6 +33,27 @@ public:
   static constexpr uint8_t OP_SUBTRACT = 4;
   static constexpr uint8_t OP_MULTIPLY = 5;
   static constexpr uint8_t OP_DIVIDE = 6;
+  static constexpr uint8_t OP_NIL = 7;
+  static constexpr uint8_t OP_POP = 8;
+  static constexpr uint8_t OP_PRINT = 9;
+  static constexpr uint8_t OP_DEFINE_GLOBAL = 10;
+  static constexpr uint8_t OP_GET_GLOBAL = 11;
+  static constexpr uint8_t OP_SET_GLOBAL = 12;
+  static constexpr uint8_t OP_BUILD_ARRAY = 13;
+  // work on raw doubles on the number stack, for expressions the compiler
+  // has proven numeric; OP_BOX moves the result onto the Value stack, and
+  // OP_BOX_UNDER moves it below the Value on top
+  static constexpr uint8_t OP_NUMBER = 14;
+  static constexpr uint8_t OP_NEGATE_F64 = 15;
+  static constexpr uint8_t OP_ADD_F64 = 16;
+  static constexpr uint8_t OP_SUBTRACT_F64 = 17;
+  static constexpr uint8_t OP_MULTIPLY_F64 = 18;
+  static constexpr uint8_t OP_DIVIDE_F64 = 19;
+  static constexpr uint8_t OP_BOX = 20;
+  static constexpr uint8_t OP_BOX_UNDER = 21;
+
+  // std::nullopt if byte isn't a valid opcode
+  static std::optional<OpCodeInfo> info(uint8_t byte);
 };
 
 class Chunk {
@@ -24,19 +62,48 @@ private:
       lineNumbers; // nth entry of this is the line number for nth byte of
                    // this.code; stored as a separate array to avoid messing
                    // with CPU cache of bytecode data
+  // the globalCount a successful verify() proved every slot is below;
+  // cleared when code is written
+  std::optional<std::size_t> verifiedGlobalCount;
 
 public:
   std::vector<uint8_t> code; // stores opcodes AND operands
   std::vector<Value> constantPool;
+  std::vector<double> numberConstants; // OP_NUMBER's, stored unboxed
+  int maxStackDepth{0}; // computed by the compiler, proven by verify()
+  int maxNumberStackDepth{0}; // likewise, for the number stack
 
   void write(uint8_t byte, int lineNumber);
+  int lineNumber(std::size_t offset) const { return lineNumbers.at(offset); }
   int addConstant(Value constant);
+  int addNumberConstant(double constant);
+  std::size_t constantCount() const {
+    return constantPool.size() + numberConstants.size();
+  }
+
+  // checks that code is well-formed enough to run without bounds checks,
+  // including that neither stack grows past its maximum depth and every
+  // global slot is below globalCount;
+  // returns a description of the first problem found, if any
+  std::optional<std::string> verify(std::size_t globalCount);
+  // whether verify() has passed since code last changed, with a globalCount
+  // no larger than this one
+  bool isVerified(std::size_t globalCount) const {
+    return verifiedGlobalCount && verifiedGlobalCount.value() <= globalCount;
+  }
 
   // debugging functionality
   void disassemble(const std::string &chunkName);
-  int disassembleInstruction(int offset);
-  int disassembleSimpleInstruction(const std::string &name, int offset);
-  int disassembleConstantInstruction(const std::string &name, int offset);
+  int disassembleInstruction(int offset, std::ostream &out = std::cout);
+  int disassembleSimpleInstruction(const std::string &name, int offset,
+                                   std::ostream &out);
+  int disassembleConstantInstruction(const std::string &name, int offset,
+                                     std::ostream &out);
+  int disassembleNumberInstruction(const std::string &name, int offset,
+                                   std::ostream &out);
+  int disassembleByteInstruction(const std::string &name, int offset,
+                                 std::ostream &out,
+                                 const std::string &operandName = "slot");
 };
 
 } // namespace lox
\ No newline at end of file
@@ -1,20 +1,45 @@
 #include "compiler.hpp"
+#include "parallel_lexer.hpp"
 #include "scanner.hpp"
 #include <string>
 
 using lox::Compiler;
 
+Compiler::Compiler(Heap &heap, Globals &globals, std::ostream &errorOut)
+    : heap(heap), globals(globals), errorOut(errorOut) {
+  // constants already added to the chunk being compiled are only reachable
+  // from here
+  heap.addRootMarker([this](Heap &heap) {
+    for (auto constant : compilingChunk.constantPool) {
+      heap.markValue(constant);
+    }
+  });
+}
+
 // abstraction because "current chunk" gets more complicated later;
 // revisit when we get to user-defined functions
 lox::Chunk &Compiler::currentChunk() { return compilingChunk; }
 
 std::optional<lox::Chunk> Compiler::compile(std::string_view source) {
-  scanner = Scanner(source);
+  if (source.size() > TokenBuffer::MAX_SOURCE_SIZE) {
+    errorOut << "Source too large to compile.\n";
+    return std::nullopt;
+  }
+
+  // tokenize everything before parsing, so the scanner runs as its own tight
+  // loop and the parser can look ahead as far as it likes
+  tokens = source.size() >= PARALLEL_LEX_THRESHOLD ? ParallelLexer(source).lex()
+                                                   : TokenBuffer::scan(source);
   compilingChunk = Chunk();
+  parser = ParserState();
+  stackDepth = 0;
+  numberStackDepth = 0;
+  resultUnboxed = false;
 
   advance();
-  expression();
-  consume(TokenType::TOKEN_EOF, "Expected end of expression");
+  while (!match(TokenType::TOKEN_EOF)) {
+    declaration();
+  }
   endCompiler();
 
   if (parser.hadError) {
@@ -35,23 +60,30 @@ void Compiler::endCompiler() {
 
 }
 
-// scan and advance to the next non-error token,
-// emitting errors if scanner emits them
+// advance to the next non-error token,
+// emitting errors for any error tokens skipped over
 void Compiler::advance() {
   parser.previous = parser.current;
+  parser.previousLine = tokens.line(parser.previous);
 
   for (;;) {
-    parser.current = scanner.scanToken();
-    if (parser.current.type != TokenType::TOKEN_ERROR) {
+    // the last token is always TOKEN_EOF; stay on it once we reach it,
+    // same as the scanner does
+    parser.current = parser.next;
+    if (parser.next + 1 < tokens.size()) {
+      parser.next++;
+    }
+
+    if (tokens.type(parser.current) != TokenType::TOKEN_ERROR) {
       break;
     }
 
-    errorAtCurrent(parser.current.lexeme);
+    errorAtCurrent(tokens.lexeme(parser.current));
   }
 }
 
 void Compiler::consume(TokenType expectedType, std::string_view errorMessage) {
-  if (parser.current.type == expectedType) {
+  if (tokens.type(parser.current) == expectedType) {
     advance();
     return;
   }
@@ -59,6 +91,48 @@ void Compiler::consume(TokenType expectedType, std::string_view errorMessage) {
   errorAtCurrent(errorMessage);
 }
 
+bool Compiler::check(TokenType type) {
+  return tokens.type(parser.current) == type;
+}
+
+bool Compiler::match(TokenType type) {
+  if (!check(type)) {
+    return false;
+  }
+
+  advance();
+  return true;
+}
+
+// skip tokens until what looks like the start of the next statement,
+// so one error doesn't cascade into many
+void Compiler::synchronize() {
+  parser.panicMode = false;
+
+  while (!check(TokenType::TOKEN_EOF)) {
+    if (tokens.type(parser.previous) == TokenType::TOKEN_SEMICOLON) {
+      return;
+    }
+
+    switch (tokens.type(parser.current)) {
+    case TokenType::TOKEN_CLASS:
+    case TokenType::TOKEN_FUN:
+    case TokenType::TOKEN_VAR:
+    case TokenType::TOKEN_FOR:
+    case TokenType::TOKEN_IF:
+    case TokenType::TOKEN_WHILE:
+    case TokenType::TOKEN_PRINT:
+    case TokenType::TOKEN_RETURN:
+      return;
+    default:
+      // intentional no-op; keep skipping
+      break;
+    }
+
+    advance();
+  }
+}
+
 void Compiler::error(std::string_view message) {
   errorAt(parser.previous, message);
 }
@@ -67,23 +141,24 @@ void Compiler::errorAtCurrent(std::string_view message) {
   errorAt(parser.current, message);
 }
 
-void Compiler::errorAt(Token token, std::string_view message) {
+void Compiler::errorAt(std::size_t tokenIndex, std::string_view message) {
   if (parser.panicMode) {
     return;
   }
 
   parser.panicMode = true;
 
-  std::cerr << "[line " << token.line << "] Error";
-  if (token.type == TokenType::TOKEN_EOF) {
-    std::cerr << " at end";
-  } else if (token.type == TokenType::TOKEN_ERROR) {
+  auto type = tokens.type(tokenIndex);
+  errorOut << "[line " << tokens.line(tokenIndex) << "] Error";
+  if (type == TokenType::TOKEN_EOF) {
+    errorOut << " at end";
+  } else if (type == TokenType::TOKEN_ERROR) {
     // intentional no-op
   } else {
-    std::cerr << " at " << token.lexeme;
+    errorOut << " at " << tokens.lexeme(tokenIndex);
   }
 
-  std::cerr << ": " << message << "\n";
+  errorOut << ": " << message << "\n";
   parser.hadError = true;
 }
 
@@ -91,24 +166,82 @@ void Compiler::errorAt(Token token, std::string_view message) {
 // parse any expression of given precedence level or higher
 void Compiler::parsePrecedence(lox::Precedence precedence) {
   advance();
-  auto prefixRule = rules.at(parser.previous.type).prefix;
+  auto prefixRule = rules.at(tokens.type(parser.previous)).prefix;
   if (!prefixRule) {
     error("Expect expression.");
     return;
   }
 
+  // only a low-precedence expression can be assigned to; `a + b = c` mustn't
+  // compile as `a + (b = c)`
+  auto canAssign = precedence <= Precedence::PREC_ASSIGNMENT;
+  parser.canAssign = canAssign;
   prefixRule.value()(*this);
 
-  while (precedence <= rules.at(parser.current.type).precedence) {
+  while (precedence <= rules.at(tokens.type(parser.current)).precedence) {
     advance();
-    auto infixRule = rules.at(parser.previous.type).infix;
+    auto infixRule = rules.at(tokens.type(parser.previous)).infix;
     if (!infixRule) {
       // programming error; should be unreachable
-      std::cerr << "Grammar error; infix parser expected, but none found.";
+      errorOut << "Grammar error; infix parser expected, but none found.";
       return;
     }
     infixRule.value()(*this);
   }
+
+  if (canAssign && match(TokenType::TOKEN_EQUAL)) {
+    error("Invalid assignment target.");
+  }
+}
+
+void Compiler::declaration() {
+  if (match(TokenType::TOKEN_VAR)) {
+    varDeclaration();
+  } else {
+    statement();
+  }
+
+  if (parser.panicMode) {
+    synchronize();
+  }
+}
+
+void Compiler::varDeclaration() {
+  consume(TokenType::TOKEN_IDENTIFIER, "Expect variable name.");
+  auto slot = globalSlot(parser.previous);
+
+  if (match(TokenType::TOKEN_EQUAL)) {
+    expression();
+    boxResult();
+  } else {
+    emitByte(OpCode::OP_NIL);
+  }
+  consume(TokenType::TOKEN_SEMICOLON,
+          "Expect ';' after variable declaration.");
+
+  emitBytePair(OpCode::OP_DEFINE_GLOBAL, slot);
+}
+
+void Compiler::statement() {
+  if (match(TokenType::TOKEN_PRINT)) {
+    printStatement();
+  } else {
+    expressionStatement();
+  }
+}
+
+void Compiler::printStatement() {
+  expression();
+  boxResult();
+  consume(TokenType::TOKEN_SEMICOLON, "Expect ';' after value.");
+  emitByte(OpCode::OP_PRINT);
+}
+
+void Compiler::expressionStatement() {
+  expression();
+  boxResult();
+  consume(TokenType::TOKEN_SEMICOLON, "Expect ';' after expression.");
+  emitByte(OpCode::OP_POP);
 }
 
 void Compiler::expression() { parsePrecedence(Precedence::PREC_ASSIGNMENT); }
@@ -118,24 +251,36 @@ void Compiler::grouping() {
   consume(TokenType::TOKEN_RIGHT_PAREN, "Expect ')' after expression.");
 }
 
+// arithmetic on two numbers is a number, so when both operands were left
+// unboxed the unboxed instruction is used and the result stays unboxed
 void Compiler::binaryOp() {
-  auto operatorType = parser.previous.type;
+  auto operatorType = tokens.type(parser.previous);
   auto rule = rules.at(operatorType);
   auto higherPrecedence = static_cast<Precedence>(1 + static_cast<int>(rule.precedence));
+  auto lhsUnboxed = resultUnboxed;
   parsePrecedence(higherPrecedence);
 
+  auto unboxed = lhsUnboxed && resultUnboxed;
+  if (!unboxed) {
+    // the generic instructions take both operands as Values, in order
+    boxResult();
+    if (lhsUnboxed) {
+      emitByte(OpCode::OP_BOX_UNDER);
+    }
+  }
+
   switch (operatorType) {
   case TokenType::TOKEN_PLUS:
-    emitByte(OpCode::OP_ADD);
+    emitByte(unboxed ? OpCode::OP_ADD_F64 : OpCode::OP_ADD);
     break;
   case TokenType::TOKEN_MINUS:
-    emitByte(OpCode::OP_SUBTRACT);
+    emitByte(unboxed ? OpCode::OP_SUBTRACT_F64 : OpCode::OP_SUBTRACT);
     break;
   case TokenType::TOKEN_STAR:
-    emitByte(OpCode::OP_MULTIPLY);
+    emitByte(unboxed ? OpCode::OP_MULTIPLY_F64 : OpCode::OP_MULTIPLY);
     break;
   case TokenType::TOKEN_SLASH:
-    emitByte(OpCode::OP_DIVIDE);
+    emitByte(unboxed ? OpCode::OP_DIVIDE_F64 : OpCode::OP_DIVIDE);
     break;
   default:
     return; // should be unreachable
@@ -143,7 +288,7 @@ void Compiler::binaryOp() {
 }
 
 void Compiler::unaryOp() {
-  auto operatorType = parser.previous.type;
+  auto operatorType = tokens.type(parser.previous);
 
   // compile the operand
   parsePrecedence(Precedence::PREC_UNARY);
@@ -151,26 +296,101 @@ void Compiler::unaryOp() {
   // emit instruction for operator
   switch (operatorType) {
   case TokenType::TOKEN_MINUS:
-    emitByte(OpCode::OP_NEGATE);
+    emitByte(resultUnboxed ? OpCode::OP_NEGATE_F64 : OpCode::OP_NEGATE);
     break;
   default:
     return; // should be unreachable
   }
 }
 
+// number literals start out unboxed; see boxResult()
 void Compiler::number() {
-  auto value = std::stod(std::string(parser.previous.lexeme));
-  emitConstant(value);
+  auto value = std::stod(std::string(tokens.lexeme(parser.previous)));
+  emitBytePair(OpCode::OP_NUMBER, makeNumberConstant(value));
+}
+
+void Compiler::string() {
+  // trim the surrounding quotes
+  auto lexeme = tokens.lexeme(parser.previous);
+  emitConstant(heap.copyString(lexeme.substr(1, lexeme.size() - 2)));
 }
 
+void Compiler::literal() {
+  switch (tokens.type(parser.previous)) {
+  case TokenType::TOKEN_NIL:
+    emitByte(OpCode::OP_NIL);
+    break;
+  default:
+    return; // should be unreachable
+  }
+}
+
+// [a, b, c]; the elements are left on the stack for OP_BUILD_ARRAY to gather
+void Compiler::arrayLiteral() {
+  int count = 0;
+  if (!check(TokenType::TOKEN_RIGHT_BRACKET)) {
+    do {
+      expression();
+      boxResult();
+      if (count == UINT8_MAX) {
+        error("Can't have more than 255 elements in an array.");
+      }
+      count++;
+    } while (match(TokenType::TOKEN_COMMA));
+  }
+  consume(TokenType::TOKEN_RIGHT_BRACKET, "Expect ']' after array elements.");
+
+  // OpCode::info() doesn't know about the elements it pops
+  stackDepth -= count;
+  emitBytePair(OpCode::OP_BUILD_ARRAY, static_cast<uint8_t>(count));
+}
+
+void Compiler::variable() { namedVariable(parser.previous); }
+
+void Compiler::namedVariable(std::size_t nameToken) {
+  auto slot = globalSlot(nameToken);
+
+  if (parser.canAssign && match(TokenType::TOKEN_EQUAL)) {
+    expression();
+    boxResult();
+    emitBytePair(OpCode::OP_SET_GLOBAL, slot);
+  } else {
+    emitBytePair(OpCode::OP_GET_GLOBAL, slot);
+  }
+}
+
+// byte is always an opcode; operands are written by emitBytePair
 void Compiler::emitByte(uint8_t byte) {
-  currentChunk().write(byte, parser.previous.line);
+  currentChunk().write(byte, parser.previousLine);
+
+  auto info = OpCode::info(byte).value();
+  stackDepth += info.pushes - info.pops;
+  if (stackDepth > currentChunk().maxStackDepth) {
+    currentChunk().maxStackDepth = stackDepth;
+    if (stackDepth > STACK_MAX) {
+      error("Expression too deeply nested; stack would overflow.");
+    }
+  }
+
+  numberStackDepth += info.numberPushes - info.numberPops;
+  if (numberStackDepth > currentChunk().maxNumberStackDepth) {
+    currentChunk().maxNumberStackDepth = numberStackDepth;
+    if (numberStackDepth > STACK_MAX) {
+      error("Expression too deeply nested; stack would overflow.");
+    }
+  }
+
+  if (info.pushes > 0) {
+    resultUnboxed = false;
+  } else if (info.numberPushes > 0) {
+    resultUnboxed = true;
+  }
 }
 
-// most often used for writing opcode, followed by one-byte operand
+// writes an opcode, followed by its one-byte operand
 void Compiler::emitBytePair(uint8_t byte1, uint8_t byte2) {
   emitByte(byte1);
-  emitByte(byte2);
+  currentChunk().write(byte2, parser.previousLine);
 }
 
 void Compiler::emitReturn() { emitByte(OpCode::OP_RETURN); }
@@ -179,12 +399,43 @@ void Compiler::emitConstant(Value value) {
   emitBytePair(OpCode::OP_CONSTANT, makeConstant(value));
 }
 
+// anything other than unboxed arithmetic takes its operands as Values
+void Compiler::boxResult() {
+  if (resultUnboxed) {
+    emitByte(OpCode::OP_BOX);
+  }
+}
+
+// the limit of 256 constants per chunk covers both pools, as if numbers were
+// still stored with the other constants
+uint8_t Compiler::makeNumberConstant(double value) {
+  auto constantIndex = currentChunk().addNumberConstant(value);
+  if (currentChunk().constantCount() > UINT8_MAX + 1) {
+    error("Too many constants in one chunk.");
+    return 0;
+  }
+
+  return static_cast<uint8_t>(constantIndex);
+}
+
 uint8_t Compiler::makeConstant(Value value) {
   auto constantIndex = currentChunk().addConstant(value);
-  if (constantIndex > UINT8_MAX) {
+  if (currentChunk().constantCount() > UINT8_MAX + 1) {
     error("Too many constants in one chunk.");
     return 0;
   }
 
   return static_cast<uint8_t>(constantIndex);
-}
\ No newline at end of file
+}
+
+// globals are resolved to a slot now, rather than looked up by name when run
+uint8_t Compiler::globalSlot(std::size_t nameToken) {
+  auto *name = heap.copyString(tokens.lexeme(nameToken));
+  auto slot = globals.resolve(name);
+  if (!slot) {
+    error("Too many global variables.");
+    return 0;
+  }
+
+  return slot.value();
+}
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "chunk.hpp"
+#include "globals.hpp"
+#include "memory.hpp"
 #include "scanner.hpp"
+#include "token_buffer.hpp"
 #include <functional>
+#include <iostream>
 #include <map>
 #include <optional>
 #include <string_view>
@@ -33,9 +37,14 @@ struct ParseRule {
   Precedence precedence;
 };
 
+// indices into the compiler's TokenBuffer
 struct ParserState {
-  Token current;
-  Token previous;
+  std::size_t current{0};
+  std::size_t previous{0};
+  std::size_t next{0}; // where advance() picks up
+  int previousLine{0}; // cached; looked up for every emitted byte
+  // whether the prefix rule being run may be the target of an assignment
+  bool canAssign{false};
   bool hadError{false};
   bool panicMode{false};
 };
@@ -43,8 +52,17 @@ struct ParserState {
 class Compiler {
 private:
   ParserState parser;
-  Scanner scanner;
+  Heap &heap; // where string constants are interned
+  Globals &globals;
+  std::ostream &errorOut; // where compile errors are reported
+  TokenBuffer tokens;
   Chunk compilingChunk;
+  int stackDepth{0}; // at the point of the next emitted instruction
+  int numberStackDepth{0};
+  // The expression just compiled is statically a number, and left it on the
+  // number stack as a raw double rather than boxed on the Value stack. Set
+  // by whichever instruction last pushed onto either stack.
+  bool resultUnboxed{false};
 
   Chunk &currentChunk();
 
@@ -52,6 +70,15 @@ private:
 
   void advance();
   void consume(TokenType expectedType, std::string_view errorMessage);
+  bool check(TokenType type);
+  bool match(TokenType type);
+  void synchronize();
+
+  void declaration();
+  void varDeclaration();
+  void statement();
+  void printStatement();
+  void expressionStatement();
 
   void parsePrecedence(Precedence precedence);
   void expression();
@@ -59,16 +86,24 @@ private:
   void binaryOp();
   void unaryOp();
   void number();
+  void string();
+  void literal();
+  void arrayLiteral();
+  void variable();
+  void namedVariable(std::size_t nameToken);
 
   uint8_t makeConstant(Value value);
+  uint8_t makeNumberConstant(double value);
+  uint8_t globalSlot(std::size_t nameToken);
 
   void emitByte(uint8_t byte);
   void emitBytePair(uint8_t byte1, uint8_t byte2);
   void emitReturn();
   void emitConstant(Value value);
+  void boxResult();
 
   void error(std::string_view message);
-  void errorAt(Token token, std::string_view message);
+  void errorAt(std::size_t tokenIndex, std::string_view message);
   void errorAtCurrent(std::string_view message);
 
   std::map<TokenType, ParseRule> rules = {
@@ -80,6 +115,10 @@ private:
        {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_RIGHT_BRACE},
        {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
+      {{TokenType::TOKEN_LEFT_BRACKET},
+       {&Compiler::arrayLiteral, std::nullopt, Precedence::PREC_NONE}},
+      {{TokenType::TOKEN_RIGHT_BRACKET},
+       {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_COMMA},
        {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_DOT},
@@ -111,9 +150,9 @@ private:
       {{TokenType::TOKEN_LESS_EQUAL},
        {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_IDENTIFIER},
-       {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
+       {&Compiler::variable, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_STRING},
-       {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
+       {&Compiler::string, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_NUMBER},
        {&Compiler::number, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_AND},
@@ -131,7 +170,7 @@ private:
       {{TokenType::TOKEN_IF},
        {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_NIL},
-       {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
+       {&Compiler::literal, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_OR},
        {std::nullopt, std::nullopt, Precedence::PREC_NONE}},
       {{TokenType::TOKEN_PRINT},
@@ -154,6 +193,11 @@ private:
        {std::nullopt, std::nullopt, Precedence::PREC_NONE}}};
 
 public:
+  // registers this compiler's roots with heap, so it mustn't be moved
+  Compiler(Heap &heap, Globals &globals, std::ostream &errorOut = std::cerr);
+  Compiler(const Compiler &) = delete;
+  Compiler &operator=(const Compiler &) = delete;
+
   std::optional<Chunk> compile(std::string_view source);
 };
 
@@ -0,0 +1,39 @@
+#include "globals.hpp"
+
+using lox::Globals;
+
+// names are interned, so the pointer identifies the name
+std::optional<uint8_t> Globals::resolve(ObjString *name) {
+  auto existing = slotsByName.find(name);
+  if (existing != slotsByName.end()) {
+    return existing->second;
+  }
+
+  if (values.size() == GLOBALS_MAX) {
+    return std::nullopt;
+  }
+
+  auto slot = static_cast<uint8_t>(values.size());
+  slotsByName.emplace(name, slot);
+  values.emplace_back();
+  defined.push_back(false);
+  names.push_back(name);
+  return slot;
+}
+
+void Globals::clear() {
+  slotsByName.clear();
+  values.clear();
+  defined.clear();
+  names.clear();
+}
+
+void Globals::markRoots(Heap &heap) {
+  for (auto *name : names) {
+    heap.markObject(name);
+  }
+
+  for (auto value : values) {
+    heap.markValue(value);
+  }
+}
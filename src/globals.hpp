@@ -0,0 +1,41 @@
+#pragma once
+
+#include "memory.hpp"
+#include "object.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+
+// most global variables one VM can have; slots are one-byte operands
+constexpr std::size_t GLOBALS_MAX = UINT8_MAX + 1;
+
+// Global variables, resolved to dense slots when they're compiled so the VM
+// reads and writes them by index instead of hashing their names. Shared by a
+// VM and its Compiler; slots live as long as the VM, so names declared by
+// one REPL line resolve to the same slot on the next.
+class Globals {
+private:
+  std::unordered_map<ObjString *, uint8_t> slotsByName;
+
+public:
+  // indexed by slot
+  std::vector<Value> values;
+  std::vector<bool> defined; // false until the var statement has run
+  std::vector<ObjString *> names; // for error messages
+
+  // slot for name, allocating one the first time it's seen;
+  // std::nullopt if all slots are taken
+  std::optional<uint8_t> resolve(ObjString *name);
+  std::size_t size() const { return values.size(); }
+  // forgets every variable and slot
+  void clear();
+
+  void markRoots(Heap &heap);
+};
+
+} // namespace lox
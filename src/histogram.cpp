@@ -0,0 +1,47 @@
+#include "histogram.hpp"
+#include <algorithm>
+#include <cstdint>
+
+using lox::LatencyHistogram;
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+  auto micros =
+      std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+
+  // the bucket is the bit length of the latency in microseconds
+  std::size_t bucket = 0;
+  for (auto remaining = static_cast<uint64_t>(std::max<int64_t>(micros, 0));
+       remaining > 0; remaining >>= 1) {
+    bucket++;
+  }
+  buckets[std::min(bucket, BUCKET_COUNT - 1)]++;
+
+  count++;
+  total += latency;
+  longest = std::max(longest, latency);
+}
+
+void LatencyHistogram::print(std::ostream &out, std::string_view name) const {
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  out << name << ": " << count << " requests";
+  if (count == 0) {
+    out << "\n";
+    return;
+  }
+
+  out << ", mean " << duration_cast<microseconds>(total).count() / count
+      << " us, max " << duration_cast<microseconds>(longest).count()
+      << " us\n";
+
+  for (std::size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+    if (buckets[bucket] == 0) {
+      continue;
+    }
+
+    uint64_t low = bucket == 0 ? 0 : uint64_t{1} << (bucket - 1);
+    uint64_t high = uint64_t{1} << bucket;
+    out << "  " << low << "-" << high << " us: " << buckets[bucket] << "\n";
+  }
+}
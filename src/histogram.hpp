@@ -0,0 +1,29 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+
+namespace lox {
+
+// Counts latencies in power-of-two buckets of microseconds: bucket 0 holds
+// everything under 1 us and bucket i holds [2^(i-1), 2^i) us, so recording
+// is constant time and the histogram is a fixed size however long it runs.
+class LatencyHistogram {
+private:
+  static constexpr std::size_t BUCKET_COUNT = 40;
+
+  std::array<std::size_t, BUCKET_COUNT> buckets{};
+  std::size_t count{0};
+  std::chrono::nanoseconds total{0};
+  std::chrono::nanoseconds longest{0};
+
+public:
+  void record(std::chrono::nanoseconds latency);
+  // only non-empty buckets are printed
+  void print(std::ostream &out, std::string_view name) const;
+};
+
+} // namespace lox
@@ -1,12 +1,25 @@
+#include "server.hpp"
 #include "vm.hpp"
+#include "zygote.hpp"
+#include <csignal>
 #include <cstdlib>
+#include <sys/resource.h>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <sstream>
+#include <string>
 
-void repl() {
-  lox::VM vm;
+[[noreturn]] void usage() {
+  std::cerr << "Usage: clox [--trace | --trace-last=N] [--gc-stats] "
+               "[--gc-stress] [--gc-growth=F] [--stats] [path]\n"
+               "       clox --serve[=socket] [--gc-stress] [--gc-growth=F]\n"
+               "       clox --zygote=socket [--gc-stress] [--gc-growth=F]\n"
+               "       clox --via=socket path\n";
+  exit(64);
+}
 
+void repl(lox::VM &vm) {
   std::cout << "> ";
   std::string inputLine;
   while (std::getline(std::cin, inputLine)) {
@@ -24,30 +37,188 @@ std::string readFile(const std::string &filename) {
   return buffer.str();
 }
 
-void runFile(const std::string &filename) {
+// returns the process exit code
+int runFile(lox::VM &vm, const std::string &filename) {
   auto source = readFile(filename);
 
-  lox::VM vm;
   auto result = vm.interpret(source);
 
   if (result == lox::InterpretResult::COMPILE_ERROR) {
-    std::exit(65);
+    return 65;
   }
 
   if (result == lox::InterpretResult::RUNTIME_ERROR) {
-    std::exit(70);
+    return 70;
+  }
+
+  return 0;
+}
+
+// requests come from stdin and responses go to stdout unless a socket path is
+// given; see server.hpp for the format
+int serve(const lox::GcConfig &gcConfig,
+          const std::optional<std::string> &socketPath) {
+  // a client hanging up shouldn't kill the server
+  std::signal(SIGPIPE, SIG_IGN);
+
+  lox::Server server(gcConfig);
+  if (!socketPath) {
+    server.serve(0, 1);
+    return 0;
   }
+
+  server.listen(socketPath.value());
+  return 74;
+}
+
+// forks a child per script sent to the socket; see zygote.hpp
+int zygote(const lox::GcConfig &gcConfig, const std::string &socketPath) {
+  std::signal(SIGPIPE, SIG_IGN);
+
+  lox::Zygote zygote(gcConfig);
+  zygote.listen(socketPath);
+  return 74;
+}
+
+// parses N out of --trace-last=N; has to be at least 1 and at most
+// lox::MAX_TRACE_CAPACITY
+std::size_t parseTraceCapacity(const std::string &option) {
+  auto digits = option.substr(option.find('=') + 1);
+  if (digits.empty() ||
+      digits.find_first_not_of("0123456789") != std::string::npos) {
+    usage();
+  }
+
+  std::size_t capacity = 0;
+  try {
+    capacity = std::stoul(digits);
+  } catch (const std::out_of_range &) {
+    usage();
+  }
+
+  if (capacity < 1 || capacity > lox::MAX_TRACE_CAPACITY) {
+    usage();
+  }
+  return capacity;
+}
+
+// parses F out of --gc-growth=F; has to be more than 1 or the heap would
+// never be allowed to grow
+double parseGrowthFactor(const std::string &option) {
+  auto text = option.substr(option.find('=') + 1);
+  std::size_t parsedLength = 0;
+  double factor = 0;
+  try {
+    factor = std::stod(text, &parsedLength);
+  } catch (const std::logic_error &) {
+    usage();
+  }
+
+  if (parsedLength != text.size() || !(factor > 1)) {
+    usage();
+  }
+  return factor;
+}
+
+// machine-readable; tool/bin/perf_check.dart parses this
+void printRunStats(const lox::VM &vm) {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::cerr << "== run stats ==\n";
+  std::cerr << "instructions:  " << vm.instructionCount() << "\n";
+  // ru_maxrss is in kilobytes on Linux
+  std::cerr << "peak rss:      " << usage.ru_maxrss << " kB\n";
 }
 
 int main(int argc, const char *argv[]) {
-  if (argc == 1) {
-    repl();
-  } else if (argc == 2) {
-    runFile(argv[1]);
+  std::optional<std::size_t> traceCapacity;
+  lox::GcConfig gcConfig;
+  bool printGcStats = false;
+  bool printStats = false;
+  std::optional<std::string> path;
+  bool serverMode = false;
+  std::optional<std::string> socketPath;
+  std::optional<std::string> zygotePath;
+  std::optional<std::string> viaPath;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--trace") {
+      traceCapacity = lox::DEFAULT_TRACE_CAPACITY;
+    } else if (arg.rfind("--trace-last=", 0) == 0) {
+      traceCapacity = parseTraceCapacity(arg);
+    } else if (arg == "--gc-stats") {
+      printGcStats = true;
+    } else if (arg == "--stats") {
+      printStats = true;
+    } else if (arg == "--gc-stress") {
+      gcConfig.stressMode = true;
+    } else if (arg.rfind("--gc-growth=", 0) == 0) {
+      gcConfig.heapGrowthFactor = parseGrowthFactor(arg);
+    } else if (arg == "--serve") {
+      serverMode = true;
+    } else if (arg.rfind("--serve=", 0) == 0) {
+      serverMode = true;
+      socketPath = arg.substr(arg.find('=') + 1);
+    } else if (arg.rfind("--zygote=", 0) == 0) {
+      zygotePath = arg.substr(arg.find('=') + 1);
+    } else if (arg.rfind("--via=", 0) == 0) {
+      viaPath = arg.substr(arg.find('=') + 1);
+    } else if (arg.rfind("--", 0) == 0 || path) {
+      usage();
+    } else {
+      path = arg;
+    }
+  }
+
+  // tracing and stats are per run, and neither mode has a run of its own to
+  // report them for
+  bool perRunOptions = traceCapacity || printGcStats || printStats;
+
+  if (serverMode) {
+    if (path || zygotePath || viaPath || perRunOptions) {
+      usage();
+    }
+    return serve(gcConfig, socketPath);
+  }
+
+  if (zygotePath) {
+    if (path || viaPath || perRunOptions) {
+      usage();
+    }
+    return zygote(gcConfig, zygotePath.value());
+  }
+
+  // kept thin: the script runs in a child of the zygote, with our stdout and
+  // stderr, and this process never builds a VM of its own
+  if (viaPath) {
+    if (!path || perRunOptions) {
+      usage();
+    }
+    return lox::runInZygote(viaPath.value(), path.value());
+  }
+
+  lox::VM vm;
+  if (traceCapacity) {
+    vm.enableTracing(traceCapacity.value());
+  }
+  vm.configureGc(gcConfig);
+
+  int exitCode = 0;
+  if (path) {
+    exitCode = runFile(vm, path.value());
   } else {
-    std::cerr << "Usage: clox [path]\n";
-    exit(64);
+    repl(vm);
   }
 
-  return 0;
+  vm.dumpTrace(std::cerr);
+  if (printGcStats) {
+    vm.printGcStats(std::cerr);
+  }
+  if (printStats) {
+    printRunStats(vm);
+  }
+
+  return exitCode;
 }
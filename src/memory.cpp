@@ -0,0 +1,196 @@
+#include "memory.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+using lox::Heap;
+
+Heap::~Heap() {
+  auto *object = objects;
+  while (object != nullptr) {
+    auto *next = object->next;
+    freeObject(object);
+    object = next;
+  }
+}
+
+// collects first, so the new object can't be swept before anything refers
+// to it
+void *Heap::allocateObject(std::size_t size) {
+  if (config.stressMode || bytesAllocated + size > nextCollection) {
+    collectGarbage();
+  }
+
+  auto *memory = ::operator new(size);
+  bytesAllocated += size;
+  return memory;
+}
+
+lox::ObjString *Heap::allocateString(std::string_view first,
+                                     std::string_view second, uint32_t hash) {
+  auto length = first.size() + second.size();
+  auto *memory = allocateObject(sizeof(ObjString) + length + 1);
+
+  auto *string = new (memory) ObjString();
+  string->type = ObjType::STRING;
+  string->isMarked = false;
+  string->length = length;
+  string->hash = hash;
+  std::memcpy(string->chars(), first.data(), first.size());
+  std::memcpy(string->chars() + first.size(), second.data(), second.size());
+  string->chars()[length] = '\0';
+
+  string->next = objects;
+  objects = string;
+  strings.insert(string);
+  return string;
+}
+
+lox::ObjArray *Heap::allocateArray(std::size_t length) {
+  auto *memory = allocateObject(sizeof(ObjArray) + length * sizeof(double));
+
+  auto *array = new (memory) ObjArray();
+  array->type = ObjType::ARRAY;
+  array->isMarked = false;
+  array->length = length;
+
+  array->next = objects;
+  objects = array;
+  return array;
+}
+
+void Heap::freeObject(Obj *object) {
+  switch (object->type) {
+  case ObjType::STRING: {
+    auto *string = static_cast<ObjString *>(object);
+    bytesAllocated -= sizeof(ObjString) + string->length + 1;
+    string->~ObjString();
+    ::operator delete(object);
+    break;
+  }
+  case ObjType::ARRAY: {
+    auto *array = static_cast<ObjArray *>(object);
+    bytesAllocated -= sizeof(ObjArray) + array->length * sizeof(double);
+    array->~ObjArray();
+    ::operator delete(object);
+    break;
+  }
+  }
+}
+
+lox::ObjString *Heap::copyString(std::string_view chars) {
+  auto hash = hashString(chars);
+  if (auto *interned = strings.find(chars, "", hash)) {
+    return interned;
+  }
+
+  return allocateString(chars, "", hash);
+}
+
+lox::ObjString *Heap::concatenate(const ObjString *lhs, const ObjString *rhs) {
+  auto hash = hashString(rhs->view(), lhs->hash);
+  if (auto *interned = strings.find(lhs->view(), rhs->view(), hash)) {
+    return interned;
+  }
+
+  return allocateString(lhs->view(), rhs->view(), hash);
+}
+
+void Heap::addRootMarker(RootMarker marker) {
+  rootMarkers.push_back(std::move(marker));
+}
+
+void Heap::markValue(Value value) {
+  if (auto *string = std::get_if<ObjString *>(&value)) {
+    markObject(*string);
+  } else if (auto *array = std::get_if<ObjArray *>(&value)) {
+    markObject(*array);
+  }
+}
+
+void Heap::markObject(Obj *object) {
+  if (object == nullptr || object->isMarked) {
+    return;
+  }
+
+  object->isMarked = true;
+  grayStack.push_back(object);
+}
+
+void Heap::collectGarbage() {
+  auto start = std::chrono::steady_clock::now();
+  auto before = bytesAllocated;
+
+  for (auto &markRoots : rootMarkers) {
+    markRoots(*this);
+  }
+  traceReferences();
+  // the intern table holds its strings weakly
+  strings.removeUnmarked();
+  sweep();
+
+  nextCollection = std::max(
+      static_cast<std::size_t>(bytesAllocated * config.heapGrowthFactor),
+      GC_MIN_THRESHOLD);
+
+  auto pause = std::chrono::steady_clock::now() - start;
+  stats.collections++;
+  stats.bytesFreed += before - bytesAllocated;
+  stats.totalPause += pause;
+  stats.longestPause = std::max<std::chrono::nanoseconds>(stats.longestPause,
+                                                          pause);
+}
+
+void Heap::traceReferences() {
+  while (!grayStack.empty()) {
+    auto *object = grayStack.back();
+    grayStack.pop_back();
+    blackenObject(object);
+  }
+}
+
+// marks everything object refers to
+void Heap::blackenObject(Obj *object) {
+  switch (object->type) {
+  case ObjType::STRING:
+  case ObjType::ARRAY:
+    // strings and number arrays don't refer to other objects
+    break;
+  }
+}
+
+void Heap::sweep() {
+  Obj *previous = nullptr;
+  auto *object = objects;
+  while (object != nullptr) {
+    if (object->isMarked) {
+      object->isMarked = false;
+      previous = object;
+      object = object->next;
+      continue;
+    }
+
+    auto *unreached = object;
+    object = object->next;
+    if (previous != nullptr) {
+      previous->next = object;
+    } else {
+      objects = object;
+    }
+    freeObject(unreached);
+  }
+}
+
+void Heap::printStats(std::ostream &out) const {
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  out << "== gc stats ==\n";
+  out << "collections:   " << stats.collections << "\n";
+  out << "bytes freed:   " << stats.bytesFreed << "\n";
+  out << "bytes in use:  " << bytesAllocated << "\n";
+  out << "total pause:   "
+      << duration_cast<microseconds>(stats.totalPause).count() << " us\n";
+  out << "longest pause: "
+      << duration_cast<microseconds>(stats.longestPause).count() << " us\n";
+}
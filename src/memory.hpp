@@ -0,0 +1,84 @@
+#pragma once
+
+#include "object.hpp"
+#include "table.hpp"
+#include "value.hpp"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace lox {
+
+// the heap never waits for less than this before collecting
+constexpr std::size_t GC_MIN_THRESHOLD = 1024 * 1024;
+
+struct GcConfig {
+  // after a collection, the next one starts once the heap has grown to this
+  // multiple of what survived
+  double heapGrowthFactor{2.0};
+  // collect before every allocation, to shake out missing roots
+  bool stressMode{false};
+};
+
+struct GcStats {
+  std::size_t collections{0};
+  std::size_t bytesFreed{0};
+  std::chrono::nanoseconds totalPause{0};
+  std::chrono::nanoseconds longestPause{0};
+};
+
+// Owns every object a VM allocates, and the table that interns its strings.
+// Unreachable objects are reclaimed by a stop-the-world mark-sweep collector
+// that runs when an allocation pushes the heap past its threshold.
+class Heap {
+public:
+  // called at the start of every collection to mark what its owner holds
+  using RootMarker = std::function<void(Heap &)>;
+
+private:
+  Obj *objects{nullptr};
+  StringTable strings;
+
+  GcConfig config;
+  GcStats stats;
+  std::size_t bytesAllocated{0};
+  std::size_t nextCollection{GC_MIN_THRESHOLD};
+
+  std::vector<RootMarker> rootMarkers;
+  std::vector<Obj *> grayStack;
+
+  void *allocateObject(std::size_t size);
+  ObjString *allocateString(std::string_view first, std::string_view second,
+                            uint32_t hash);
+  void freeObject(Obj *object);
+
+  void collectGarbage();
+  void traceReferences();
+  void blackenObject(Obj *object);
+  void sweep();
+
+public:
+  Heap() = default;
+  ~Heap();
+
+  Heap(const Heap &) = delete;
+  Heap &operator=(const Heap &) = delete;
+
+  // returns the interned string equal to chars, creating it if needed
+  ObjString *copyString(std::string_view chars);
+  ObjString *concatenate(const ObjString *lhs, const ObjString *rhs);
+  // elements are left uninitialized for the caller to fill in
+  ObjArray *allocateArray(std::size_t length);
+
+  void addRootMarker(RootMarker marker);
+  void markValue(Value value);
+  void markObject(Obj *object);
+
+  void configure(const GcConfig &newConfig) { config = newConfig; }
+  void printStats(std::ostream &out) const;
+};
+
+} // namespace lox
@@ -0,0 +1,10 @@
+#include "object.hpp"
+
+uint32_t lox::hashString(std::string_view chars, uint32_t seed) {
+  auto hash = seed;
+  for (auto c : chars) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619U;
+  }
+  return hash;
+}
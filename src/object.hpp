@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace lox {
+
+enum class ObjType { STRING, ARRAY };
+
+// header shared by every heap-allocated value
+struct Obj {
+  ObjType type;
+  bool isMarked; // reachable, as of the collection in progress
+  Obj *next;     // intrusive list of every object the Heap owns
+};
+
+// Immutable, interned string. The characters are stored directly after the
+// struct in the same allocation, so creating one is a single allocation.
+struct ObjString : Obj {
+  std::size_t length;
+  uint32_t hash; // computed once, at creation
+
+  const char *chars() const { return reinterpret_cast<const char *>(this + 1); }
+  char *chars() { return reinterpret_cast<char *>(this + 1); }
+  std::string_view view() const { return {chars(), length}; }
+};
+
+// Fixed-length array of numbers. The elements are packed directly after the
+// struct, so element-wise arithmetic can run over them with SIMD.
+struct ObjArray : Obj {
+  std::size_t length;
+
+  const double *elements() const {
+    return reinterpret_cast<const double *>(this + 1);
+  }
+  double *elements() { return reinterpret_cast<double *>(this + 1); }
+};
+
+// FNV-1a; pass a previous result as seed to continue hashing where it left off
+uint32_t hashString(std::string_view chars, uint32_t seed = 2166136261U);
+
+} // namespace lox
@@ -0,0 +1,60 @@
+#include "output.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+using lox::OutputBuffer;
+
+OutputBuffer::OutputBuffer(std::ostream &target, std::size_t capacity)
+    : target(target), buffer(std::max<std::size_t>(capacity, 64)) {}
+
+OutputBuffer::~OutputBuffer() { flush(); }
+
+void OutputBuffer::write(std::string_view text) {
+  if (used + text.size() > buffer.size()) {
+    flush();
+
+    // too big to ever fit; don't bother copying it
+    if (text.size() > buffer.size()) {
+      target.write(text.data(), text.size());
+      return;
+    }
+  }
+
+  std::memcpy(buffer.data() + used, text.data(), text.size());
+  used += text.size();
+}
+
+// iostreams print doubles like printf's "%g": 6 significant digits, switching
+// to exponent notation for very large or small magnitudes. That's what the
+// clox test suite expects, so keep it rather than printing the shortest
+// round-trip form.
+void OutputBuffer::writeNumber(double number) {
+  constexpr int PRECISION = 6;
+  // worst case is something like "-1.23457e-308"
+  constexpr std::size_t MAX_LENGTH = 24;
+
+  if (buffer.size() - used < MAX_LENGTH) {
+    flush();
+  }
+
+  auto *first = buffer.data() + used;
+#if __cpp_lib_to_chars >= 201611L
+  auto result = std::to_chars(first, first + MAX_LENGTH, number,
+                              std::chars_format::general, PRECISION);
+  used += result.ptr - first;
+#else
+  used += std::snprintf(first, MAX_LENGTH, "%.*g", PRECISION, number);
+#endif
+}
+
+void OutputBuffer::flush() {
+  if (used == 0) {
+    return;
+  }
+
+  target.write(buffer.data(), used);
+  target.flush();
+  used = 0;
+}
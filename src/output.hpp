@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace lox {
+
+constexpr std::size_t OUTPUT_BUFFER_SIZE = 64 * 1024;
+
+// Collects program output and hands it to the target stream in large blocks,
+// instead of going through iostream formatting for every value printed.
+// Flushed when full, on flush(), and on destruction.
+class OutputBuffer {
+private:
+  std::ostream &target;
+  std::vector<char> buffer;
+  std::size_t used{0};
+
+public:
+  explicit OutputBuffer(std::ostream &target = std::cout,
+                        std::size_t capacity = OUTPUT_BUFFER_SIZE);
+  ~OutputBuffer();
+
+  OutputBuffer(const OutputBuffer &) = delete;
+  OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+  void write(std::string_view text);
+  // same text as `std::cout << number` with default stream settings
+  void writeNumber(double number);
+  void flush();
+};
+
+} // namespace lox
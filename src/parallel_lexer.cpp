@@ -0,0 +1,96 @@
+#include "parallel_lexer.hpp"
+#include <algorithm>
+
+using lox::ParallelLexer;
+
+ParallelLexer::ParallelLexer(std::string_view source, unsigned int threadCount)
+    : source(source), segmentCount(std::max(threadCount, 1U)) {}
+
+// Quick pre-pass over the raw characters to find where it's safe to cut.
+// Lox strings can span lines but have no escapes, and comments always end at a
+// newline, so a newline outside of a string literal is a safe boundary; the
+// scanner will be in its initial state right after it.
+std::vector<lox::SourceSegment> ParallelLexer::splitSource() {
+  std::vector<SourceSegment> segments;
+  auto targetSize = source.size() / segmentCount + 1;
+
+  std::size_t segmentStart = 0;
+  int segmentFirstLine = 1;
+  int line = 1;
+  bool inString = false;
+  bool inComment = false;
+
+  for (std::size_t i = 0; i < source.size(); i++) {
+    auto c = source[i];
+    if (c == '\n') {
+      line++;
+      inComment = false;
+
+      auto segmentLength = i + 1 - segmentStart;
+      if (!inString && segmentLength >= targetSize) {
+        segments.push_back(
+            {source.substr(segmentStart, segmentLength), segmentFirstLine});
+        segmentStart = i + 1;
+        segmentFirstLine = line;
+      }
+    } else if (inComment) {
+      // intentional no-op; quotes inside comments don't start strings
+    } else if (c == '"') {
+      inString = !inString;
+    } else if (!inString && c == '/' && i + 1 < source.size() &&
+               source[i + 1] == '/') {
+      inComment = true;
+      i++;
+    }
+  }
+
+  // remainder may be empty; lexing it still yields the final TOKEN_EOF with
+  // the right line number
+  segments.push_back({source.substr(segmentStart), segmentFirstLine});
+  return segments;
+}
+
+// lexemes still point into the full source, so segment buffers can be
+// stitched together without touching their offsets
+lox::TokenBuffer ParallelLexer::lexSegment(SourceSegment segment) {
+  TokenBuffer tokens(source);
+  Scanner scanner(segment.text, segment.firstLine);
+
+  for (;;) {
+    auto token = scanner.scanToken();
+    tokens.append(token);
+    if (token.type == TokenType::TOKEN_EOF) {
+      return tokens;
+    }
+  }
+}
+
+lox::TokenBuffer ParallelLexer::lex() {
+  auto segments = splitSource();
+  std::vector<TokenBuffer> segmentTokens(segments.size());
+
+  std::vector<std::thread> workers;
+  workers.reserve(segments.size());
+  for (std::size_t i = 0; i < segments.size(); i++) {
+    workers.emplace_back([this, &segments, &segmentTokens, i]() {
+      segmentTokens.at(i) = lexSegment(segments.at(i));
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  // stitch segments together in source order; every segment but the last
+  // ends with an EOF token that has to be dropped
+  TokenBuffer tokens(source);
+  for (std::size_t i = 0; i < segmentTokens.size(); i++) {
+    const auto &segment = segmentTokens.at(i);
+    auto count = segment.size();
+    if (i + 1 < segmentTokens.size()) {
+      count--;
+    }
+    tokens.append(segment, count);
+  }
+
+  return tokens;
+}
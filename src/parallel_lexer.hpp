@@ -0,0 +1,40 @@
+#pragma once
+
+#include "scanner.hpp"
+#include "token_buffer.hpp"
+#include <cstddef>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace lox {
+
+// below this size, starting threads costs more than lexing on one thread
+constexpr std::size_t PARALLEL_LEX_THRESHOLD = 1 << 20; // 1 MiB
+
+// a piece of the source that can be lexed independently of its neighbours;
+// always ends just after a newline that isn't inside a string literal
+struct SourceSegment {
+  std::string_view text;
+  int firstLine;
+};
+
+class ParallelLexer {
+private:
+  std::string_view source;
+  unsigned int segmentCount;
+
+  std::vector<SourceSegment> splitSource();
+  TokenBuffer lexSegment(SourceSegment segment);
+
+public:
+  explicit ParallelLexer(
+      std::string_view source,
+      unsigned int threadCount = std::thread::hardware_concurrency());
+
+  // returns every token in the source, in order, ending with a single
+  // TOKEN_EOF
+  TokenBuffer lex();
+};
+
+} // namespace lox
@@ -30,6 +30,10 @@ lox::Token Scanner::scanToken() {
     return makeToken(TokenType::TOKEN_LEFT_BRACE);
   case '}':
     return makeToken(TokenType::TOKEN_RIGHT_BRACE);
+  case '[':
+    return makeToken(TokenType::TOKEN_LEFT_BRACKET);
+  case ']':
+    return makeToken(TokenType::TOKEN_RIGHT_BRACKET);
   case ';':
     return makeToken(TokenType::TOKEN_SEMICOLON);
   case ',':
@@ -120,7 +124,7 @@ char Scanner::peek() {
 }
 
 char Scanner::peekNext() {
-  if (isAtEnd()) {
+  if (currentPosition + 1 >= source.size()) {
     return '\0';
   }
 
@@ -140,7 +144,8 @@ lox::Token Scanner::makeToken(lox::TokenType type) {
           line};
 }
 
-lox::Token Scanner::errorToken(const std::string &message) {
+// message must outlive the token; in practice it's always a string literal
+lox::Token Scanner::errorToken(std::string_view message) {
   return {TokenType::TOKEN_ERROR, message, line};
 }
 
@@ -265,9 +270,9 @@ lox::TokenType Scanner::checkKeyword(std::size_t prefixLength,
   return TokenType::TOKEN_IDENTIFIER;
 }
 
-lox::Scanner::Scanner(std::string_view source) {
+lox::Scanner::Scanner(std::string_view source, int firstLine) {
   this->source = source;
   this->startPosition = 0;
   this->currentPosition = 0;
-  this->line = 1;
+  this->line = firstLine;
 };
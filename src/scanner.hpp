@@ -1,15 +1,18 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 
 namespace lox {
-enum class TokenType {
+enum class TokenType : uint8_t {
   // Single-character tokens.
   TOKEN_LEFT_PAREN,
   TOKEN_RIGHT_PAREN,
   TOKEN_LEFT_BRACE,
   TOKEN_RIGHT_BRACE,
+  TOKEN_LEFT_BRACKET,
+  TOKEN_RIGHT_BRACKET,
   TOKEN_COMMA,
   TOKEN_DOT,
   TOKEN_MINUS,
@@ -72,7 +75,7 @@ private:
   bool isDigit(char c);
   bool isAtEnd();
   Token makeToken(TokenType type);
-  Token errorToken(const std::string &message);
+  Token errorToken(std::string_view message);
   char advance();
   bool match(char expected);
   void skipWhitespace();
@@ -86,7 +89,7 @@ private:
                          TokenType type);
 
 public:
-  explicit Scanner(std::string_view source = "");
+  explicit Scanner(std::string_view source = "", int firstLine = 1);
 
   Token scanToken();
 };
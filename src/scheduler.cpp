@@ -0,0 +1,78 @@
+#include "scheduler.hpp"
+#include <algorithm>
+#include <utility>
+
+using lox::Scheduler;
+
+Scheduler::Scheduler(unsigned int threadCount, std::size_t sliceBudget)
+    : sliceBudget(sliceBudget) {
+  // hardware_concurrency() is 0 when it can't tell
+  threadCount = std::max(threadCount, 1U);
+  for (unsigned int i = 0; i < threadCount; i++) {
+    workers.emplace_back([this] { workerLoop(); });
+  }
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    shuttingDown = true;
+  }
+  taskAvailable.notify_all();
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void Scheduler::submit(std::unique_ptr<VM> vm, Completion onComplete) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    runQueue.push_back(Task{std::move(vm), std::move(onComplete)});
+    unfinished++;
+  }
+  taskAvailable.notify_one();
+}
+
+void Scheduler::waitUntilIdle() {
+  std::unique_lock<std::mutex> lock(mutex);
+  allFinished.wait(lock, [this] { return unfinished == 0; });
+}
+
+void Scheduler::workerLoop() {
+  for (;;) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      taskAvailable.wait(lock,
+                         [this] { return shuttingDown || !runQueue.empty(); });
+      // only stop once the queue has drained
+      if (runQueue.empty()) {
+        return;
+      }
+      task = std::move(runQueue.front());
+      runQueue.pop_front();
+    }
+
+    // the VM is only run outside the lock; it belongs to this worker until
+    // it's queued again
+    auto result = task.vm->resume(sliceBudget);
+
+    if (result == InterpretResult::YIELDED) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        runQueue.push_back(std::move(task));
+      }
+      taskAvailable.notify_one();
+      continue;
+    }
+
+    task.onComplete(std::move(task.vm), result);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    unfinished--;
+    if (unfinished == 0) {
+      allFinished.notify_all();
+    }
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "vm.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lox {
+
+// instructions a VM runs before it goes to the back of the queue
+constexpr std::size_t DEFAULT_SLICE_BUDGET = 10000;
+
+// Runs many VMs on a small, fixed pool of threads. Each worker takes the VM
+// at the front of the queue, resumes it for one slice of instructions, and
+// puts it back at the end if it yielded, so a long-running script delays the
+// others by at most one slice per worker instead of tying a thread up.
+class Scheduler {
+public:
+  // called on a worker thread when a VM's program has finished; hands the
+  // VM back so it can be reused
+  using Completion = std::function<void(std::unique_ptr<VM>, InterpretResult)>;
+
+private:
+  struct Task {
+    std::unique_ptr<VM> vm;
+    Completion onComplete;
+  };
+
+  std::size_t sliceBudget;
+
+  std::mutex mutex; // guards everything below
+  std::deque<Task> runQueue;
+  std::size_t unfinished{0}; // queued or being run
+  bool shuttingDown{false};
+  std::condition_variable taskAvailable;
+  std::condition_variable allFinished;
+
+  std::vector<std::thread> workers;
+
+  void workerLoop();
+
+public:
+  explicit Scheduler(
+      unsigned int threadCount = std::thread::hardware_concurrency(),
+      std::size_t sliceBudget = DEFAULT_SLICE_BUDGET);
+  // finishes everything already submitted, then stops the workers
+  ~Scheduler();
+
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  // vm must have a program load()ed; it's only touched by one worker at a time
+  void submit(std::unique_ptr<VM> vm, Completion onComplete);
+  // blocks until every submitted VM has finished
+  void waitUntilIdle();
+};
+
+} // namespace lox
@@ -0,0 +1,52 @@
+#include "script_cache.hpp"
+#include <functional>
+
+using lox::ScriptCache;
+
+ScriptCache::ScriptCache(std::size_t capacity) : capacity(capacity) {}
+
+std::shared_ptr<const lox::CompiledScript>
+ScriptCache::find(std::string_view source) {
+  auto hash = std::hash<std::string_view>{}(source);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto existing = entriesByHash.find(hash);
+  if (existing == entriesByHash.end() || existing->second->source != source) {
+    misses++;
+    return nullptr;
+  }
+
+  hits++;
+  entries.splice(entries.begin(), entries, existing->second);
+  return existing->second->script;
+}
+
+// a source whose hash collides with a cached one replaces it
+void ScriptCache::insert(std::string_view source,
+                         std::shared_ptr<const CompiledScript> script) {
+  auto hash = std::hash<std::string_view>{}(source);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto existing = entriesByHash.find(hash);
+  if (existing != entriesByHash.end()) {
+    existing->second->source = source;
+    existing->second->script = std::move(script);
+    entries.splice(entries.begin(), entries, existing->second);
+    return;
+  }
+
+  entries.push_front(Entry{std::string(source), std::move(script)});
+  entriesByHash.emplace(hash, entries.begin());
+
+  if (entries.size() > capacity) {
+    entriesByHash.erase(std::hash<std::string_view>{}(entries.back().source));
+    entries.pop_back();
+  }
+}
+
+void ScriptCache::printStats(std::ostream &out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  out << "cached scripts: " << entries.size() << "\n";
+  out << "cache hits:     " << hits << "\n";
+  out << "cache misses:   " << misses << "\n";
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "chunk.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+constexpr std::size_t SCRIPT_CACHE_CAPACITY = 256; // in scripts
+
+// A compiled script detached from the VM that compiled it, so any VM can
+// load it. Its objects lived in that VM's heap, so string constants are kept
+// as text and interned again by whichever VM loads it; global slots are
+// numbered in the order of globalNames.
+struct CompiledScript {
+  Chunk chunk; // string constants are nil placeholders
+  std::vector<std::pair<uint8_t, std::string>> stringConstants; // by index
+  std::vector<std::string> globalNames;                         // by slot
+};
+
+// Least-recently-used cache of compiled scripts, keyed by source. Safe to
+// share between threads; scripts are handed out as shared pointers so one
+// evicted while a VM is loading it stays valid.
+class ScriptCache {
+private:
+  struct Entry {
+    std::string source; // compared on lookup, in case of hash collisions
+    std::shared_ptr<const CompiledScript> script;
+  };
+
+  std::size_t capacity;
+
+  std::mutex mutex; // guards everything below
+  std::list<Entry> entries; // most recently used first
+  std::unordered_map<std::size_t, std::list<Entry>::iterator> entriesByHash;
+  std::size_t hits{0};
+  std::size_t misses{0};
+
+public:
+  explicit ScriptCache(std::size_t capacity = SCRIPT_CACHE_CAPACITY);
+
+  // nullptr if source hasn't been compiled, or has been evicted
+  std::shared_ptr<const CompiledScript> find(std::string_view source);
+  void insert(std::string_view source,
+              std::shared_ptr<const CompiledScript> script);
+
+  void printStats(std::ostream &out);
+};
+
+} // namespace lox
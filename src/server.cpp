@@ -0,0 +1,178 @@
+#include "server.hpp"
+#include "socket_io.hpp"
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+using lox::Server;
+
+Server::Server(const GcConfig &gcConfig, std::size_t poolSize) {
+  for (std::size_t i = 0; i < poolSize; i++) {
+    auto session = std::make_unique<Session>();
+    session->vm = std::make_unique<VM>(session->out, session->err);
+    session->vm->configureGc(gcConfig);
+    idleSessions.push_back(session.get());
+    sessions.push_back(std::move(session));
+  }
+}
+
+// blocks while every session is busy, which stops the caller reading more
+// requests than the pool can take
+Server::Session *Server::acquireSession() {
+  std::unique_lock<std::mutex> lock(poolMutex);
+  sessionAvailable.wait(lock, [this] { return !idleSessions.empty(); });
+  auto *session = idleSessions.back();
+  idleSessions.pop_back();
+  return session;
+}
+
+void Server::releaseSession(Session *session) {
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    idleSessions.push_back(session);
+  }
+  sessionAvailable.notify_one();
+}
+
+void Server::serve(int inFd, int outFd) {
+  auto connection = std::make_shared<Connection>();
+  connection->outFd = outFd;
+
+  for (uint32_t requestNumber = 0;; requestNumber++) {
+    char kind = 0;
+    uint32_t length = 0;
+    if (!readFully(inFd, &kind, 1) || !readLength(inFd, length) ||
+        length > MAX_REQUEST_SIZE) {
+      break;
+    }
+
+    std::string payload(length, '\0');
+    if (!readFully(inFd, payload.data(), length)) {
+      break;
+    }
+    auto received = std::chrono::steady_clock::now();
+
+    switch (static_cast<RequestKind>(kind)) {
+    case RequestKind::RUN:
+      run(connection, requestNumber, payload, received);
+      break;
+    case RequestKind::STATS:
+      respond(*connection, requestNumber, 0, statistics(), "");
+      break;
+    default:
+      respond(*connection, requestNumber, 64, "", "Unknown request kind.\n");
+      break;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(connection->mutex);
+  connection->drained.wait(lock,
+                           [&] { return connection->outstanding == 0; });
+}
+
+// compiles or loads the script here, on the connection's thread, then leaves
+// running it to the scheduler
+void Server::run(const std::shared_ptr<Connection> &connection,
+                 uint32_t requestNumber, const std::string &source,
+                 std::chrono::steady_clock::time_point received) {
+  auto *session = acquireSession();
+  session->out.str("");
+  session->err.str("");
+  session->vm->reset();
+
+  auto &vm = *session->vm;
+  auto script = cache.find(source);
+  bool wasCached = script != nullptr;
+  auto result = wasCached ? vm.load(*script) : vm.load(source);
+  if (result != InterpretResult::OK) {
+    finish(*connection, session, requestNumber, result, received, wasCached);
+    return;
+  }
+  if (!wasCached) {
+    cache.insert(source, std::make_shared<const CompiledScript>(
+                             vm.exportScript()));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(connection->mutex);
+    connection->outstanding++;
+  }
+
+  // the connection is shared so it outlives serve() if that returns first
+  scheduler.submit(std::move(session->vm), [this, connection, session,
+                                            requestNumber, received,
+                                            wasCached](std::unique_ptr<VM> vm,
+                                                       InterpretResult result) {
+    session->vm = std::move(vm);
+    finish(*connection, session, requestNumber, result, received, wasCached);
+
+    std::lock_guard<std::mutex> lock(connection->mutex);
+    connection->outstanding--;
+    if (connection->outstanding == 0) {
+      connection->drained.notify_all();
+    }
+  });
+}
+
+void Server::finish(Connection &connection, Session *session,
+                    uint32_t requestNumber, InterpretResult result,
+                    std::chrono::steady_clock::time_point received,
+                    bool wasCached) {
+  auto output = session->out.str();
+  auto errors = session->err.str();
+  releaseSession(session);
+
+  respond(connection, requestNumber, exitStatus(result), output, errors);
+
+  auto latency = std::chrono::steady_clock::now() - received;
+  std::lock_guard<std::mutex> lock(statsMutex);
+  (wasCached ? cachedLatency : compiledLatency).record(latency);
+}
+
+std::string Server::statistics() {
+  std::ostringstream out;
+  out << "== server stats ==\n";
+  cache.printStats(out);
+
+  std::lock_guard<std::mutex> lock(statsMutex);
+  cachedLatency.print(out, "latency, cached");
+  compiledLatency.print(out, "latency, compiled");
+  return out.str();
+}
+
+// a client that has gone away just misses its response
+void Server::respond(Connection &connection, uint32_t requestNumber,
+                     uint8_t status, const std::string &output,
+                     const std::string &errors) {
+  std::string frame;
+  frame.reserve(13 + output.size() + errors.size());
+  appendLength(frame, requestNumber);
+  frame += static_cast<char>(status);
+  appendLength(frame, static_cast<uint32_t>(output.size()));
+  frame += output;
+  appendLength(frame, static_cast<uint32_t>(errors.size()));
+  frame += errors;
+
+  std::lock_guard<std::mutex> lock(connection.mutex);
+  writeFully(connection.outFd, frame.data(), frame.size());
+}
+
+bool Server::listen(const std::string &path) {
+  int listener = listenOnSocket(path);
+  if (listener < 0) {
+    return false;
+  }
+
+  for (;;) {
+    int client = accept(listener, nullptr, nullptr);
+    if (client < 0) {
+      continue;
+    }
+
+    std::thread([this, client] {
+      serve(client, client);
+      close(client);
+    }).detach();
+  }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "histogram.hpp"
+#include "memory.hpp"
+#include "scheduler.hpp"
+#include "script_cache.hpp"
+#include "vm.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+constexpr std::size_t SERVER_POOL_SIZE = 64; // VMs kept warm
+constexpr uint32_t MAX_REQUEST_SIZE = 64 * 1024 * 1024;
+
+// Wire format; every length is a 4-byte big-endian unsigned integer.
+//   request:  kind, length, payload
+//   response: request number, status, length, output, length, errors
+// Requests are numbered from 0 on each connection. A response is sent as soon
+// as its script finishes, so responses can arrive out of order. The status is
+// the exit code main would have returned: 0, 65 or 70.
+enum class RequestKind : uint8_t {
+  RUN = 'r',   // payload is a script to run
+  STATS = 's', // payload is ignored; output is the server's statistics
+};
+
+// Runs scripts for any number of connections on a pool of warm VMs, each
+// request starting from fresh globals. Compiled scripts are kept in a shared
+// cache, so sending the same source again skips the compiler.
+class Server {
+private:
+  // a pooled VM and the streams it writes to
+  struct Session {
+    std::ostringstream out;
+    std::ostringstream err;
+    std::unique_ptr<VM> vm;
+  };
+
+  // responses can be written from any scheduler thread
+  struct Connection {
+    int outFd;
+    std::mutex mutex; // guards writes and outstanding
+    std::size_t outstanding{0};
+    std::condition_variable drained;
+  };
+
+  ScriptCache cache;
+
+  std::mutex poolMutex; // guards idleSessions
+  std::condition_variable sessionAvailable;
+  std::vector<std::unique_ptr<Session>> sessions;
+  std::vector<Session *> idleSessions;
+
+  std::mutex statsMutex; // guards the histograms
+  LatencyHistogram cachedLatency;   // scripts found in the cache
+  LatencyHistogram compiledLatency; // scripts that had to be compiled
+
+  // declared last so it's destroyed first, while what its tasks use is alive
+  Scheduler scheduler;
+
+  Session *acquireSession();
+  void releaseSession(Session *session);
+
+  void run(const std::shared_ptr<Connection> &connection,
+           uint32_t requestNumber, const std::string &source,
+           std::chrono::steady_clock::time_point received);
+  void finish(Connection &connection, Session *session, uint32_t requestNumber,
+              InterpretResult result,
+              std::chrono::steady_clock::time_point received, bool wasCached);
+  std::string statistics();
+  void respond(Connection &connection, uint32_t requestNumber, uint8_t status,
+               const std::string &output, const std::string &errors);
+
+public:
+  explicit Server(const GcConfig &gcConfig,
+                  std::size_t poolSize = SERVER_POOL_SIZE);
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  // answers requests read from inFd on outFd until inFd is closed or sends
+  // something malformed; returns once every response has been written
+  void serve(int inFd, int outFd);
+  // serves every connection to a Unix socket at path; only returns, with
+  // false, if it can't listen there
+  bool listen(const std::string &path);
+};
+
+} // namespace lox
@@ -0,0 +1,100 @@
+#include "socket_io.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+bool lox::readFully(int fd, char *buffer, std::size_t length) {
+  while (length > 0) {
+    auto received = read(fd, buffer, length);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    buffer += received;
+    length -= static_cast<std::size_t>(received);
+  }
+  return true;
+}
+
+bool lox::writeFully(int fd, const char *buffer, std::size_t length) {
+  while (length > 0) {
+    auto written = write(fd, buffer, length);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    buffer += written;
+    length -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+bool lox::readLength(int fd, uint32_t &length) {
+  unsigned char bytes[4];
+  if (!readFully(fd, reinterpret_cast<char *>(bytes), sizeof(bytes))) {
+    return false;
+  }
+  length = decodeLength(bytes);
+  return true;
+}
+
+uint32_t lox::decodeLength(const unsigned char bytes[4]) {
+  return uint32_t{bytes[0]} << 24 | uint32_t{bytes[1]} << 16 |
+         uint32_t{bytes[2]} << 8 | uint32_t{bytes[3]};
+}
+
+void lox::appendLength(std::string &frame, uint32_t length) {
+  frame += static_cast<char>(length >> 24);
+  frame += static_cast<char>(length >> 16);
+  frame += static_cast<char>(length >> 8);
+  frame += static_cast<char>(length);
+}
+
+uint8_t lox::exitStatus(InterpretResult result) {
+  switch (result) {
+  case InterpretResult::COMPILE_ERROR:
+    return 65;
+  case InterpretResult::RUNTIME_ERROR:
+    return 70;
+  default:
+    return 0;
+  }
+}
+
+int lox::listenOnSocket(const std::string &path) {
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path too long: " << path << "\n";
+    return -1;
+  }
+  address.sun_family = AF_UNIX;
+  std::strcpy(address.sun_path, path.c_str());
+
+  // clear out a socket left behind by an earlier server, but nothing else
+  struct stat existing {};
+  if (stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+    unlink(path.c_str());
+  }
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 ||
+      bind(listener, reinterpret_cast<sockaddr *>(&address),
+           sizeof(address)) < 0 ||
+      ::listen(listener, SOMAXCONN) < 0) {
+    std::cerr << "Can't listen on " << path << ": " << std::strerror(errno)
+              << "\n";
+    if (listener >= 0) {
+      close(listener);
+    }
+    return -1;
+  }
+  return listener;
+}
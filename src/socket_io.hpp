@@ -0,0 +1,27 @@
+#pragma once
+
+#include "vm.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lox {
+
+// Blocking I/O helpers shared by the server and the zygote. Lengths on the
+// wire are 4-byte big-endian unsigned integers.
+
+// false at end of file or on an error
+bool readFully(int fd, char *buffer, std::size_t length);
+bool writeFully(int fd, const char *buffer, std::size_t length);
+bool readLength(int fd, uint32_t &length);
+uint32_t decodeLength(const unsigned char bytes[4]);
+void appendLength(std::string &frame, uint32_t length);
+
+// the exit code main returns for result: 0, 65 or 70
+uint8_t exitStatus(InterpretResult result);
+
+// a listening Unix socket at path, replacing a socket left behind by an
+// earlier server; -1 with the reason written to std::cerr if that fails
+int listenOnSocket(const std::string &path);
+
+} // namespace lox
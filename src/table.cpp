@@ -0,0 +1,78 @@
+#include "table.hpp"
+#include <cstring>
+
+using lox::StringTable;
+
+constexpr std::size_t TABLE_MIN_CAPACITY = 8;
+
+lox::ObjString *StringTable::find(std::string_view first,
+                                  std::string_view second,
+                                  uint32_t hash) const {
+  if (entries.empty()) {
+    return nullptr;
+  }
+
+  auto mask = entries.size() - 1;
+  for (auto index = hash & mask;; index = (index + 1) & mask) {
+    const auto &entry = entries[index];
+    if (entry.key == nullptr) {
+      if (!entry.tombstone) {
+        return nullptr;
+      }
+      continue;
+    }
+
+    auto *key = entry.key;
+    if (key->hash == hash && key->length == first.size() + second.size() &&
+        std::memcmp(key->chars(), first.data(), first.size()) == 0 &&
+        std::memcmp(key->chars() + first.size(), second.data(),
+                    second.size()) == 0) {
+      return key;
+    }
+  }
+}
+
+void StringTable::insert(ObjString *string) {
+  // keep load factor at or below 3/4
+  if (4 * (count + 1) > 3 * entries.size()) {
+    grow();
+  }
+
+  auto mask = entries.size() - 1;
+  auto index = string->hash & mask;
+  while (entries[index].key != nullptr) {
+    index = (index + 1) & mask;
+  }
+
+  // reusing a tombstone doesn't change the count
+  auto &entry = entries[index];
+  if (!entry.tombstone) {
+    count++;
+  }
+  entry.key = string;
+  entry.tombstone = false;
+}
+
+void StringTable::removeUnmarked() {
+  for (auto &entry : entries) {
+    if (entry.key != nullptr && !entry.key->isMarked) {
+      entry.key = nullptr;
+      entry.tombstone = true;
+    }
+  }
+}
+
+// also drops tombstones, since everything gets reinserted
+void StringTable::grow() {
+  auto capacity =
+      entries.empty() ? TABLE_MIN_CAPACITY : entries.size() * 2;
+  std::vector<Entry> oldEntries(capacity);
+  entries.swap(oldEntries);
+  count = 0;
+
+  for (const auto &entry : oldEntries) {
+    if (entry.key != nullptr) {
+      insert(entry.key);
+    }
+  }
+}
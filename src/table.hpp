@@ -0,0 +1,37 @@
+#pragma once
+
+#include "object.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace lox {
+
+// Open-addressing hash set of every live string, used to intern them.
+// Probes linearly; capacity is always a power of two. The table doesn't keep
+// strings alive: the collector removes unreachable ones before sweeping,
+// leaving tombstones so later probes still find what's past them.
+class StringTable {
+private:
+  struct Entry {
+    ObjString *key{nullptr};
+    bool tombstone{false};
+  };
+
+  std::vector<Entry> entries;
+  std::size_t count{0}; // live entries plus tombstones
+
+  void grow();
+
+public:
+  // looks for a string equal to first + second, which hash to hash;
+  // taking two pieces lets concatenation check before allocating anything
+  ObjString *find(std::string_view first, std::string_view second,
+                  uint32_t hash) const;
+  // string mustn't already be in the table
+  void insert(ObjString *string);
+  void removeUnmarked();
+};
+
+} // namespace lox
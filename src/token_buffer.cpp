@@ -0,0 +1,82 @@
+#include "token_buffer.hpp"
+#include <algorithm>
+
+using lox::TokenBuffer;
+
+TokenBuffer::TokenBuffer(std::string_view source) : source(source) {}
+
+TokenBuffer TokenBuffer::scan(std::string_view source) {
+  TokenBuffer buffer(source);
+  Scanner scanner(source);
+
+  for (;;) {
+    auto token = scanner.scanToken();
+    buffer.append(token);
+    if (token.type == TokenType::TOKEN_EOF) {
+      return buffer;
+    }
+  }
+}
+
+void TokenBuffer::appendLine(uint32_t tokenIndex, int line) {
+  if (lineRunLines.empty() || lineRunLines.back() != line) {
+    lineRunStarts.push_back(tokenIndex);
+    lineRunLines.push_back(line);
+  }
+}
+
+void TokenBuffer::append(const Token &token) {
+  appendLine(types.size(), token.line);
+  types.push_back(token.type);
+
+  if (token.type == TokenType::TOKEN_ERROR) {
+    offsets.push_back(errorMessages.size());
+    lengths.push_back(0);
+    errorMessages.push_back(token.lexeme);
+    return;
+  }
+
+  offsets.push_back(token.lexeme.data() - source.data());
+  lengths.push_back(token.lexeme.size());
+}
+
+void TokenBuffer::append(const TokenBuffer &other, std::size_t count) {
+  auto base = types.size();
+  auto errorBase = errorMessages.size();
+
+  types.insert(types.end(), other.types.begin(), other.types.begin() + count);
+  offsets.insert(offsets.end(), other.offsets.begin(),
+                 other.offsets.begin() + count);
+  lengths.insert(lengths.end(), other.lengths.begin(),
+                 other.lengths.begin() + count);
+
+  // error offsets index the other buffer's messages
+  for (auto i = base; i < types.size(); i++) {
+    if (types[i] == TokenType::TOKEN_ERROR) {
+      offsets[i] += errorBase;
+    }
+  }
+  errorMessages.insert(errorMessages.end(), other.errorMessages.begin(),
+                       other.errorMessages.end());
+
+  for (std::size_t run = 0; run < other.lineRunStarts.size() &&
+                            other.lineRunStarts[run] < count;
+       run++) {
+    appendLine(base + other.lineRunStarts[run], other.lineRunLines[run]);
+  }
+}
+
+std::string_view TokenBuffer::lexeme(std::size_t index) const {
+  if (types[index] == TokenType::TOKEN_ERROR) {
+    return errorMessages[offsets[index]];
+  }
+
+  return source.substr(offsets[index], lengths[index]);
+}
+
+int TokenBuffer::line(std::size_t index) const {
+  // find the last run starting at or before index
+  auto nextRun =
+      std::upper_bound(lineRunStarts.begin(), lineRunStarts.end(), index);
+  return lineRunLines[nextRun - lineRunStarts.begin() - 1];
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "scanner.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace lox {
+
+// Every token of a source, stored as parallel arrays instead of an array of
+// Tokens so the parser's working set stays small; a token is just an index.
+// Lexemes are (offset, length) pairs into the source, except for TOKEN_ERROR,
+// whose offset indexes errorMessages instead. Line numbers only change at
+// newlines, so they're stored run-length encoded: run n covers the tokens from
+// lineRunStarts[n] up to the start of run n + 1.
+class TokenBuffer {
+private:
+  std::string_view source;
+
+  std::vector<TokenType> types;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> lengths;
+
+  std::vector<uint32_t> lineRunStarts;
+  std::vector<int> lineRunLines;
+
+  std::vector<std::string_view> errorMessages;
+
+  void appendLine(uint32_t tokenIndex, int line);
+
+public:
+  // sources are addressed with 32-bit offsets
+  static constexpr std::size_t MAX_SOURCE_SIZE = UINT32_MAX;
+
+  explicit TokenBuffer(std::string_view source = "");
+
+  // runs the scanner over the whole source in one tight loop
+  static TokenBuffer scan(std::string_view source);
+
+  // token's lexeme must point into this buffer's source, unless it's an error
+  void append(const Token &token);
+  // appends the first count tokens of other, which must share this source
+  void append(const TokenBuffer &other, std::size_t count);
+
+  std::size_t size() const { return types.size(); }
+
+  TokenType type(std::size_t index) const { return types[index]; }
+  std::string_view lexeme(std::size_t index) const;
+  int line(std::size_t index) const;
+};
+
+} // namespace lox
@@ -0,0 +1,49 @@
+#include "trace.hpp"
+#include <algorithm>
+
+using lox::ExecutionTrace;
+
+ExecutionTrace::ExecutionTrace(std::size_t capacity)
+    : records(capacity) {}
+
+void ExecutionTrace::clear() {
+  nextRecord = 0;
+  totalRecorded = 0;
+}
+
+void ExecutionTrace::markRoots(Heap &heap) {
+  auto retained = std::min(totalRecorded, records.size());
+  auto oldest = totalRecorded > records.size() ? nextRecord : 0;
+  for (std::size_t i = 0; i < retained; i++) {
+    const auto &record = records[(oldest + i) % records.size()];
+    if (record.hasStackTop) {
+      heap.markValue(record.stackTop);
+    }
+  }
+}
+
+void ExecutionTrace::dump(Chunk &chunk, std::ostream &out) {
+  if (totalRecorded == 0) {
+    return;
+  }
+
+  auto retained = std::min(totalRecorded, records.size());
+  out << "== trace: last " << retained << " of " << totalRecorded
+      << " instructions ==\n";
+
+  // once the buffer has wrapped, the oldest record is the next one to be
+  // overwritten
+  auto oldest = totalRecorded > records.size() ? nextRecord : 0;
+  for (std::size_t i = 0; i < retained; i++) {
+    const auto &record = records[(oldest + i) % records.size()];
+
+    chunk.disassembleInstruction(record.instructionPointer, out);
+    out << "          ";
+    if (record.hasStackTop) {
+      out << "[ ";
+      printValue(record.stackTop, out);
+      out << " ]";
+    }
+    out << "\n";
+  }
+}
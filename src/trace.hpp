@@ -0,0 +1,61 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "memory.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace lox {
+
+constexpr std::size_t DEFAULT_TRACE_CAPACITY = 1024;
+// keeps a trace buffer to a few tens of megabytes
+constexpr std::size_t MAX_TRACE_CAPACITY = 1 << 20;
+
+// one executed instruction, captured just before it ran
+struct TraceRecord {
+  uint32_t instructionPointer;
+  bool hasStackTop; // false if the stack was empty
+  Value stackTop;
+};
+
+// Fixed-size ring buffer of the most recently executed instructions.
+// Recording is a single store, so it's cheap enough to leave on in production;
+// records are only decoded into readable disassembly when dumped.
+class ExecutionTrace {
+private:
+  std::vector<TraceRecord> records;
+  std::size_t nextRecord{0};
+  std::size_t totalRecorded{0};
+
+public:
+  // capacity must be from 1 to MAX_TRACE_CAPACITY
+  explicit ExecutionTrace(std::size_t capacity = DEFAULT_TRACE_CAPACITY);
+
+  void record(std::size_t instructionPointer, const Value *stackTop) {
+    auto &slot = records[nextRecord];
+    slot.instructionPointer = static_cast<uint32_t>(instructionPointer);
+    slot.hasStackTop = stackTop != nullptr;
+    if (stackTop != nullptr) {
+      slot.stackTop = *stackTop;
+    }
+
+    nextRecord++;
+    if (nextRecord == records.size()) {
+      nextRecord = 0;
+    }
+    totalRecorded++;
+  }
+
+  void clear();
+  // keeps recorded values alive so they can still be printed
+  void markRoots(Heap &heap);
+
+  // writes retained records, oldest first; chunk must be the one they were
+  // recorded from
+  void dump(Chunk &chunk, std::ostream &out);
+};
+
+} // namespace lox
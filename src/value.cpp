@@ -1,49 +1,88 @@
 #include "value.hpp"
-#include <functional>
+#include "memory.hpp"
 
 // taken from https://www.cppstories.com/2018/09/visit-variants/ to allow using
 // lambdas inside std::visit calls
 template <class... Ts> struct overload : Ts... { using Ts::operator()...; };
 template <class... Ts> overload(Ts...) -> overload<Ts...>;
 
-void lox::printValue(Value val) {
-  std::visit(overload{[](double d) { std::cout << d; }}, val);
+// arrays print as [1, 2, 3]
+void lox::printValue(Value val, std::ostream &out) {
+  std::visit(overload{[&out](std::monostate) { out << "nil"; },
+                      [&out](double d) { out << d; },
+                      [&out](ObjString *string) { out << string->view(); },
+                      [&out](ObjArray *array) {
+                        out << "[";
+                        for (std::size_t i = 0; i < array->length; i++) {
+                          out << (i == 0 ? "" : ", ") << array->elements()[i];
+                        }
+                        out << "]";
+                      }},
+             val);
 }
 
-lox::Value lox::negateValue(Value val) {
-  return std::visit(overload{[](double d) { return -1 * d; }}, val);
-};
-
-std::function<lox::Value(lox::Value, lox::Value)>
-lox::createArithmeticBinaryOp(const std::function<double(double, double)> &op) {
-  return [=](Value lhs, Value rhs) {
-    return std::visit(overload{[=](double lhDouble, double rhDouble) {
-                        return op(lhDouble, rhDouble);
+void lox::printValue(Value val, OutputBuffer &out) {
+  std::visit(overload{[&out](std::monostate) { out.write("nil"); },
+                      [&out](double d) { out.writeNumber(d); },
+                      [&out](ObjString *string) { out.write(string->view()); },
+                      [&out](ObjArray *array) {
+                        out.write("[");
+                        for (std::size_t i = 0; i < array->length; i++) {
+                          if (i > 0) {
+                            out.write(", ");
+                          }
+                          out.writeNumber(array->elements()[i]);
+                        }
+                        out.write("]");
                       }},
-                      lhs, rhs);
-  };
-};
-
-lox::Value lox::addValues(Value lhs, Value rhs) {
-  auto func = createArithmeticBinaryOp(
-      [](double lhs, double rhs) { return lhs + rhs; });
-  return func(lhs, rhs);
+             val);
 }
 
-lox::Value lox::subtractValues(Value lhs, Value rhs) {
-  auto func = createArithmeticBinaryOp(
-      [](double lhs, double rhs) { return lhs - rhs; });
-  return func(lhs, rhs);
-}
+// -x is computed as -1 * x, like OP_NEGATE on a number, so the sign of zero
+// flips
+std::optional<lox::Value> lox::negateArray(Heap &heap, Value val) {
+  auto *array = std::get_if<ObjArray *>(&val);
+  if (array == nullptr) {
+    return std::nullopt;
+  }
 
-lox::Value lox::multiplyValues(Value lhs, Value rhs) {
-  auto func = createArithmeticBinaryOp(
-      [](double lhs, double rhs) { return lhs * rhs; });
-  return func(lhs, rhs);
+  auto *result = heap.allocateArray((*array)->length);
+  double minusOne = -1;
+  applyArrayOp(ArrayOp::MULTIPLY, &minusOne, true, (*array)->elements(), false,
+               result->elements(), result->length);
+  return result;
 }
 
-lox::Value lox::divideValues(Value lhs, Value rhs) {
-  auto func = createArithmeticBinaryOp(
-      [](double lhs, double rhs) { return lhs / rhs; });
-  return func(lhs, rhs);
+std::optional<lox::Value> lox::arrayBinaryOp(Heap &heap, ArrayOp op,
+                                             Value lhs, Value rhs) {
+  auto *lhsArray = std::get_if<ObjArray *>(&lhs);
+  auto *rhsArray = std::get_if<ObjArray *>(&rhs);
+  auto *lhsNumber = std::get_if<double>(&lhs);
+  auto *rhsNumber = std::get_if<double>(&rhs);
+
+  if (lhsArray != nullptr && rhsArray != nullptr) {
+    if ((*lhsArray)->length != (*rhsArray)->length) {
+      return std::nullopt;
+    }
+    auto *result = heap.allocateArray((*lhsArray)->length);
+    applyArrayOp(op, (*lhsArray)->elements(), false, (*rhsArray)->elements(),
+                 false, result->elements(), result->length);
+    return result;
+  }
+
+  if (lhsArray != nullptr && rhsNumber != nullptr) {
+    auto *result = heap.allocateArray((*lhsArray)->length);
+    applyArrayOp(op, (*lhsArray)->elements(), false, rhsNumber, true,
+                 result->elements(), result->length);
+    return result;
+  }
+
+  if (lhsNumber != nullptr && rhsArray != nullptr) {
+    auto *result = heap.allocateArray((*rhsArray)->length);
+    applyArrayOp(op, lhsNumber, true, (*rhsArray)->elements(), false,
+                 result->elements(), result->length);
+    return result;
+  }
+
+  return std::nullopt;
 }
@@ -1,19 +1,27 @@
 #pragma once
 
-#include <functional>
+#include "array_kernels.hpp"
+#include "object.hpp"
+#include "output.hpp"
 #include <iostream>
+#include <optional>
 #include <variant>
 
 namespace lox {
-using Value = std::variant<double>;
+class Heap;
 
-void printValue(Value val);
-Value negateValue(Value val);
+// std::monostate is nil;
+// strings are interned, so comparing Values compares string identity
+using Value = std::variant<std::monostate, double, ObjString *, ObjArray *>;
 
-std::function<Value(Value, Value)>
-createArithmeticBinaryOp(const std::function<double(double, double)> &);
-Value addValues(Value lhs, Value rhs);
-Value subtractValues(Value lhs, Value rhs);
-Value multiplyValues(Value lhs, Value rhs);
-Value divideValues(Value lhs, Value rhs);
-} // namespace lox
\ No newline at end of file
+void printValue(Value val, std::ostream &out = std::cout);
+void printValue(Value val, OutputBuffer &out);
+
+// Element-wise arithmetic on number arrays: two arrays must be the same length,
+// and a number is broadcast to every element of the other operand. Results
+// are new arrays allocated in heap, so the operands must be reachable from a
+// root. std::nullopt unless one operand is an array and these rules hold.
+std::optional<Value> negateArray(Heap &heap, Value val);
+std::optional<Value> arrayBinaryOp(Heap &heap, ArrayOp op, Value lhs,
+                                   Value rhs);
+} // namespace lox
@@ -1,108 +1,486 @@
 #include "vm.hpp"
 #include "chunk.hpp"
-#include <deque>
+#include <functional>
 #include <iostream>
 #include <string>
 
 using lox::VM;
 
+VM::VM(std::ostream &out, std::ostream &err)
+    : errorOutput(err), output(out) {
+  heap.addRootMarker([this](Heap &) { markRoots(); });
+}
+
+void VM::markRoots() {
+  for (size_t slot = 0; slot < stackTop; slot++) {
+    heap.markValue(stack[slot]);
+  }
+
+  for (auto constant : codeChunk.constantPool) {
+    heap.markValue(constant);
+  }
+
+  globals.markRoots(heap);
+
+  if (trace) {
+    trace->markRoots(heap);
+  }
+}
+
+// no bounds checks; only verified chunks are run
 uint8_t VM::readByte() {
-  auto executingInstruction = codeChunk.code.at(instructionPointer);
+  auto executingInstruction = codeChunk.code[instructionPointer];
   instructionPointer++;
   return executingInstruction;
 }
 
-lox::Value VM::readConstant() { return codeChunk.constantPool.at(readByte()); }
+lox::Value VM::readConstant() { return codeChunk.constantPool[readByte()]; }
+
+void VM::push(Value value) {
+  stack[stackTop] = value;
+  stackTop++;
+}
+
+lox::Value VM::pop() {
+  stackTop--;
+  return stack[stackTop];
+}
 
 lox::InterpretResult VM::interpret(const std::string &source) {
+  auto result = load(source);
+  if (result != InterpretResult::OK) {
+    return result;
+  }
+
+  return resume();
+}
+
+lox::InterpretResult VM::load(const std::string &source) {
+  suspended = false;
+
   auto possibleChunk = compiler.compile(source);
   if (!possibleChunk) {
     return InterpretResult::COMPILE_ERROR;
   }
 
   codeChunk = possibleChunk.value();
+  return prepareToRun();
+}
+
+lox::InterpretResult VM::load(const CompiledScript &script) {
+  suspended = false;
+
+  // fresh globals resolve the names to slots in the same order
+  globals.clear();
+  for (const auto &name : script.globalNames) {
+    globals.resolve(heap.copyString(name));
+  }
+
+  // interned straight into codeChunk, where they're roots for the collector
+  codeChunk = script.chunk;
+  for (const auto &[index, chars] : script.stringConstants) {
+    codeChunk.constantPool[index] = heap.copyString(chars);
+  }
+
+  return prepareToRun();
+}
+
+lox::CompiledScript VM::exportScript() const {
+  CompiledScript script;
+  script.chunk = codeChunk;
+
+  auto &constants = script.chunk.constantPool;
+  for (std::size_t index = 0; index < constants.size(); index++) {
+    if (auto *string = std::get_if<ObjString *>(&constants[index])) {
+      script.stringConstants.emplace_back(static_cast<uint8_t>(index),
+                                          (*string)->view());
+      constants[index] = std::monostate();
+    }
+  }
+
+  for (auto *name : globals.names) {
+    script.globalNames.emplace_back(name->view());
+  }
+
+  return script;
+}
+
+void VM::reset() {
+  suspended = false;
+  globals.clear();
+  stackTop = 0;
+  numberTop = 0;
+}
+
+lox::InterpretResult VM::prepareToRun() {
   instructionPointer = 0;
 
-  return run();
+  // scripts from the cache were verified by the VM that compiled them, and
+  // load() recreates the same globals
+  if (!codeChunk.isVerified(globals.size())) {
+    if (auto problem = codeChunk.verify(globals.size())) {
+      errorOutput << "Invalid bytecode at " << problem.value() << "\n";
+      return InterpretResult::COMPILE_ERROR;
+    }
+  }
+
+#ifdef TOS_CACHING
+  // run() starts by filling its cached top from slot 0, the placeholder for
+  // an empty stack
+  stack.resize(codeChunk.maxStackDepth + 1);
+  stack[0] = std::monostate();
+  stackTop = 1;
+#else
+  stack.resize(codeChunk.maxStackDepth);
+  stackTop = 0;
+#endif
+  numbers.resize(codeChunk.maxNumberStackDepth);
+  numberTop = 0;
+
+  if (trace) {
+    trace->clear();
+  }
+
+  suspended = true;
+  return InterpretResult::OK;
 }
 
-// prints stack from bottom to top
-void VM::printStackContents() {
-  std::cout << "          ";
-  std::deque<Value> tempStack;
+lox::InterpretResult VM::resume(std::size_t instructionBudget) {
+  if (!suspended) {
+    return InterpretResult::OK;
+  }
+
+  // saturates, so UNLIMITED_BUDGET never wraps around
+  budgetEnd = instructionBudget < UNLIMITED_BUDGET - instructionsExecuted
+                  ? instructionsExecuted + instructionBudget
+                  : UNLIMITED_BUDGET;
+
+  auto result = run();
+  if (result == InterpretResult::YIELDED) {
+    return result;
+  }
 
-  while (!stack.empty()) {
-    tempStack.push_front(stack.top());
-    stack.pop();
+  suspended = false;
+  output.flush();
+  if (result == InterpretResult::RUNTIME_ERROR) {
+    dumpTrace(errorOutput);
   }
 
-  for (auto &it : tempStack) {
-    std::cout << "[ ";
-    printValue(it);
-    std::cout << " ]";
+  return result;
+}
+
+lox::InterpretResult
+VM::resumeUntil(std::chrono::steady_clock::time_point deadline) {
+  for (;;) {
+    auto result = resume(DEADLINE_CHECK_INTERVAL);
+    if (result != InterpretResult::YIELDED ||
+        std::chrono::steady_clock::now() >= deadline) {
+      return result;
+    }
   }
-  std::cout << "\n";
+}
 
-  for (auto elem : tempStack) {
-    stack.push(elem);
+void VM::enableTracing(std::size_t capacity) { trace.emplace(capacity); }
+
+// prints the trace of the most recent interpret(), then forgets it
+void VM::dumpTrace(std::ostream &out) {
+  if (!trace) {
+    return;
   }
+
+  trace->dump(codeChunk, out);
+  trace->clear();
 }
 
+// With TOS_CACHING defined, the top of the stack is kept in a local, so it
+// can live in a register, and only the values under it are in stack memory.
+// The local is spilled back to memory before anything that reads the stack
+// array, can collect garbage, or leaves run(). An empty stack caches a nil
+// placeholder, which prepareToRun() leaves in slot 0.
 lox::InterpretResult VM::run() {
-  for (;;) {
-#ifdef DEBUG_TRACE_EXECUTION
-    codeChunk.disassembleInstruction(instructionPointer);
-    printStackContents();
+#ifdef TOS_CACHING
+  Value top;
+  auto spill = [&] { stack[stackTop++] = top; };
+  auto fill = [&] { top = stack[--stackTop]; };
+  auto pushValue = [&](Value value) {
+    spill();
+    top = value;
+  };
+  auto popValue = [&] {
+    auto value = top;
+    fill();
+    return value;
+  };
+  auto peek = [&]() -> Value & { return top; };
+  auto peekSecond = [&]() -> Value & { return stack[stackTop - 1]; };
+  auto depth = [&] { return stackTop; }; // the placeholder is never counted
+
+  fill();
+#else
+  auto spill = [] {};
+  auto fill = [] {};
+  auto pushValue = [this](Value value) { push(value); };
+  auto popValue = [this] { return pop(); };
+  auto peek = [this]() -> Value & { return stack[stackTop - 1]; };
+  auto peekSecond = [this]() -> Value & { return stack[stackTop - 2]; };
+  auto depth = [this] { return stackTop; };
 #endif
-    switch (readByte()) {
-    case OpCode::OP_RETURN: {
-      auto topOfStack = stack.top();
-      stack.pop();
 
-      std::cout << "top of stack:"
-                << "\n";
-      printValue(topOfStack);
-      std::cout << "\n";
+  // Numbers are the common case for every arithmetic instruction, so they're
+  // computed in place: on the cached top and the slot under it, with no
+  // spill. False, leaving the stack untouched, unless both are numbers.
+  auto numberBinaryOperation = [&](auto op) {
+    auto *rhs = std::get_if<double>(&peek());
+    auto *lhs = std::get_if<double>(&peekSecond());
+    if (lhs == nullptr || rhs == nullptr) {
+      return false;
+    }
+
+    auto result = op(*lhs, *rhs);
+    popValue();
+    peek() = result;
+    return true;
+  };
+
+  for (;;) {
+    // checked before anything is recorded, so resuming doesn't repeat work
+    if (instructionsExecuted == budgetEnd) {
+      spill();
+      return InterpretResult::YIELDED;
+    }
+
+    if (trace) {
+      trace->record(instructionPointer, depth() > 0 ? &peek() : nullptr);
+    }
 
+    instructionsExecuted++;
+    switch (readByte()) {
+    case OpCode::OP_RETURN: {
+      spill();
       return InterpretResult::OK;
     }
     case OpCode::OP_CONSTANT: {
       auto constantValue = readConstant();
-      stack.push(constantValue);
+      pushValue(constantValue);
+      break;
+    }
+    case OpCode::OP_NIL: {
+      pushValue(std::monostate());
+      break;
+    }
+    case OpCode::OP_POP: {
+      popValue();
+      break;
+    }
+    case OpCode::OP_PRINT: {
+      printValue(popValue(), output);
+      output.write("\n");
+      break;
+    }
+    case OpCode::OP_DEFINE_GLOBAL: {
+      auto slot = readByte();
+      globals.values[slot] = popValue();
+      globals.defined[slot] = true;
+      break;
+    }
+    case OpCode::OP_GET_GLOBAL: {
+      auto slot = readByte();
+      if (!globals.defined[slot]) {
+        return undefinedVariableError(slot);
+      }
+      pushValue(globals.values[slot]);
+      break;
+    }
+    case OpCode::OP_SET_GLOBAL: {
+      auto slot = readByte();
+      if (!globals.defined[slot]) {
+        return undefinedVariableError(slot);
+      }
+      // assignment is an expression, so leave the value on the stack
+      globals.values[slot] = peek();
+      break;
+    }
+    case OpCode::OP_BUILD_ARRAY: {
+      std::size_t count = readByte();
+      spill();
+      // the elements stay on the stack, where the collector can see them,
+      // until the array has been allocated
+      auto *array = heap.allocateArray(count);
+      auto first = stackTop - count;
+      for (std::size_t i = 0; i < count; i++) {
+        auto *number = std::get_if<double>(&stack[first + i]);
+        if (number == nullptr) {
+          return runtimeError("Array elements must be numbers.");
+        }
+        array->elements()[i] = *number;
+      }
+
+      stackTop = first;
+      push(array);
+      fill();
+      break;
+    }
+    case OpCode::OP_NUMBER: {
+      numbers[numberTop] = codeChunk.numberConstants[readByte()];
+      numberTop++;
+      break;
+    }
+    case OpCode::OP_NEGATE_F64: {
+      numbers[numberTop - 1] = -1 * numbers[numberTop - 1];
+      break;
+    }
+    case OpCode::OP_ADD_F64: {
+      numberTop--;
+      numbers[numberTop - 1] = numbers[numberTop - 1] + numbers[numberTop];
+      break;
+    }
+    case OpCode::OP_SUBTRACT_F64: {
+      numberTop--;
+      numbers[numberTop - 1] = numbers[numberTop - 1] - numbers[numberTop];
+      break;
+    }
+    case OpCode::OP_MULTIPLY_F64: {
+      numberTop--;
+      numbers[numberTop - 1] = numbers[numberTop - 1] * numbers[numberTop];
+      break;
+    }
+    case OpCode::OP_DIVIDE_F64: {
+      numberTop--;
+      numbers[numberTop - 1] = numbers[numberTop - 1] / numbers[numberTop];
+      break;
+    }
+    case OpCode::OP_BOX: {
+      numberTop--;
+      pushValue(numbers[numberTop]);
+      break;
+    }
+    case OpCode::OP_BOX_UNDER: {
+      auto above = popValue();
+      numberTop--;
+      pushValue(numbers[numberTop]);
+      pushValue(above);
       break;
     }
     case OpCode::OP_NEGATE: {
-      auto top = stack.top();
-      stack.pop();
-      stack.push(negateValue(top));
+      if (auto *number = std::get_if<double>(&peek())) {
+        *number = -1 * *number;
+        break;
+      }
+
+      spill();
+      auto result = negateArray(heap, stack[stackTop - 1]);
+      if (!result) {
+        return runtimeError("Operand must be a number.");
+      }
+      stack[stackTop - 1] = result.value();
+      fill();
       break;
     }
     case OpCode::OP_ADD: {
-      assembleBinaryOperation(addValues);
+      if (numberBinaryOperation(std::plus<double>())) {
+        break;
+      }
+
+      // strings and arrays allocate, so the collector has to see the stack
+      spill();
+      auto *rhs = std::get_if<ObjString *>(&stack[stackTop - 1]);
+      auto *lhs = std::get_if<ObjString *>(&stack[stackTop - 2]);
+      if (lhs != nullptr && rhs != nullptr) {
+        auto *result = heap.concatenate(*lhs, *rhs);
+        pop();
+        stack[stackTop - 1] = result;
+        fill();
+        break;
+      }
+
+      if (!assembleArrayOperation(ArrayOp::ADD)) {
+        return binaryOperandError(
+            "Operands must be two numbers or two strings.");
+      }
+      fill();
       break;
     }
     case OpCode::OP_SUBTRACT: {
-      assembleBinaryOperation(subtractValues);
+      if (numberBinaryOperation(std::minus<double>())) {
+        break;
+      }
+
+      spill();
+      if (!assembleArrayOperation(ArrayOp::SUBTRACT)) {
+        return binaryOperandError("Operands must be numbers.");
+      }
+      fill();
       break;
     }
     case OpCode::OP_MULTIPLY: {
-      assembleBinaryOperation(multiplyValues);
+      if (numberBinaryOperation(std::multiplies<double>())) {
+        break;
+      }
+
+      spill();
+      if (!assembleArrayOperation(ArrayOp::MULTIPLY)) {
+        return binaryOperandError("Operands must be numbers.");
+      }
+      fill();
       break;
     }
     case OpCode::OP_DIVIDE: {
-      assembleBinaryOperation(divideValues);
+      if (numberBinaryOperation(std::divides<double>())) {
+        break;
+      }
+
+      spill();
+      if (!assembleArrayOperation(ArrayOp::DIVIDE)) {
+        return binaryOperandError("Operands must be numbers.");
+      }
+      fill();
       break;
     }
     }
   }
 }
 
-void VM::assembleBinaryOperation(
-    std::function<lox::Value(lox::Value, lox::Value)> binaryOp) {
-  auto rhs = stack.top();
-  stack.pop();
-  auto lhs = stack.top();
-  stack.pop();
-  auto result = binaryOp(lhs, rhs);
-  stack.push(result);
-}
\ No newline at end of file
+// returns false, leaving the stack untouched, unless both operands are arrays,
+// or an array and a number; allocates the result while both are still on the
+// stack
+bool VM::assembleArrayOperation(ArrayOp op) {
+  auto result =
+      arrayBinaryOp(heap, op, stack[stackTop - 2], stack[stackTop - 1]);
+  if (!result) {
+    return false;
+  }
+
+  pop();
+  stack[stackTop - 1] = result.value();
+  return true;
+}
+
+// message is for operands that aren't arrays, so the clox errors are unchanged
+lox::InterpretResult VM::binaryOperandError(std::string_view message) {
+  if (std::holds_alternative<ObjArray *>(stack[stackTop - 1]) ||
+      std::holds_alternative<ObjArray *>(stack[stackTop - 2])) {
+    return runtimeError(
+        "Operands must be numbers or arrays of the same length.");
+  }
+  return runtimeError(message);
+}
+
+lox::InterpretResult VM::runtimeError(std::string_view message) {
+  output.flush();
+
+  errorOutput << message << "\n";
+  // instructionPointer has already moved past the failing instruction
+  errorOutput << "[line " << codeChunk.lineNumber(instructionPointer - 1)
+            << "] in script\n";
+
+  stackTop = 0;
+  numberTop = 0;
+  return InterpretResult::RUNTIME_ERROR;
+}
+
+lox::InterpretResult VM::undefinedVariableError(uint8_t slot) {
+  std::string message = "Undefined variable '";
+  message += globals.names[slot]->view();
+  message += "'.";
+  return runtimeError(message);
+}
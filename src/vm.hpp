@@ -2,18 +2,38 @@
 
 #include "chunk.hpp"
 #include "compiler.hpp"
+#include "globals.hpp"
+#include "memory.hpp"
+#include "output.hpp"
+#include "script_cache.hpp"
+#include "trace.hpp"
 #include "value.hpp"
-#include <functional>
-#include <stack>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <vector>
 #include <string>
 
 namespace lox {
 
-enum class InterpretResult { OK, COMPILE_ERROR, RUNTIME_ERROR };
+// YIELDED means the instruction budget ran out; call resume() to carry on
+enum class InterpretResult { OK, COMPILE_ERROR, RUNTIME_ERROR, YIELDED };
+
+constexpr std::size_t UNLIMITED_BUDGET = SIZE_MAX;
+
+// resumeUntil() reads the clock once per this many instructions
+constexpr std::size_t DEADLINE_CHECK_INTERVAL = 1024;
 
 class VM {
 private:
-  lox::Compiler compiler;
+  std::ostream &errorOutput; // compile and runtime errors
+
+  // heap and globals are declared before compiler, which uses them
+  lox::Heap heap;
+  lox::Globals globals;
+  lox::Compiler compiler{heap, globals, errorOutput};
 
   lox::Chunk codeChunk;
 
@@ -21,20 +41,67 @@ private:
   // address of an instruction in codeChunk.code
   size_t instructionPointer; // raw C pointer in Crafting Interpreters; may
                              // need to change this later?
-  std::stack<Value> stack;
+  // sized to the chunk's proven maximum depth, so pushes are unchecked
+  std::vector<Value> stack;
+  size_t stackTop{0}; // index of the slot the next push goes into
+  // raw doubles for the unboxed arithmetic instructions; also sized from the
+  // chunk
+  std::vector<double> numbers;
+  size_t numberTop{0};
+
+  OutputBuffer output; // everything the running program prints
+
+  // only present when tracing is switched on; covers the latest interpret()
+  std::optional<ExecutionTrace> trace;
+
+  std::size_t instructionsExecuted{0}; // across every interpret() call
+  // run() yields once instructionsExecuted reaches this
+  std::size_t budgetEnd{UNLIMITED_BUDGET};
+  bool suspended{false}; // a loaded program hasn't finished yet
 
+  InterpretResult prepareToRun();
   InterpretResult run();
   uint8_t readByte();
   Value readConstant();
+  void push(Value value);
+  Value pop();
 
-  void assembleBinaryOperation(
-      std::function<lox::Value(lox::Value, lox::Value)>);
-
-  // debugging functionality
-  void printStackContents();
+  bool assembleArrayOperation(ArrayOp op);
+  InterpretResult binaryOperandError(std::string_view message);
+  InterpretResult runtimeError(std::string_view message);
+  InterpretResult undefinedVariableError(uint8_t slot);
+  void markRoots();
 
 public:
+  explicit VM(std::ostream &out = std::cout, std::ostream &err = std::cerr);
+
+  // load() then resume() with no budget
   InterpretResult interpret(const std::string &source);
+
+  // compiles source, ready for resume(); OK or COMPILE_ERROR
+  InterpretResult load(const std::string &source);
+  // loads a script compiled by any VM, replacing this one's globals with
+  // the script's
+  InterpretResult load(const CompiledScript &script);
+  // the loaded program, in a form any VM can load
+  CompiledScript exportScript() const;
+  // forgets all globals and any suspended program
+  void reset();
+  // runs the loaded program until it finishes or has executed
+  // instructionBudget more instructions, in which case it's YIELDED with its
+  // instruction pointer and stack intact; OK if nothing is loaded
+  InterpretResult resume(std::size_t instructionBudget = UNLIMITED_BUDGET);
+  // as resume(), but yields at the first check after deadline has passed
+  InterpretResult resumeUntil(std::chrono::steady_clock::time_point deadline);
+
+  // keep the last capacity executed instructions for dumpTrace()
+  void enableTracing(std::size_t capacity);
+  void dumpTrace(std::ostream &out);
+
+  void configureGc(const GcConfig &config) { heap.configure(config); }
+  void printGcStats(std::ostream &out) const { heap.printStats(out); }
+
+  std::size_t instructionCount() const { return instructionsExecuted; }
 };
 
 } // namespace lox
\ No newline at end of file
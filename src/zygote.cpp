@@ -0,0 +1,242 @@
+#include "zygote.hpp"
+#include "socket_io.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using lox::Zygote;
+
+namespace {
+
+constexpr int PASSED_FDS = 2; // stdout, stderr
+constexpr int REQUEST_TIMEOUT_SECONDS = 1;
+
+// same as main: a missing file reads as an empty script
+std::string readSource(const std::string &path) {
+  std::ifstream readStream(path);
+  std::stringstream buffer;
+  buffer << readStream.rdbuf();
+  return buffer.str();
+}
+
+// the request header along with the descriptors sent with it; false if the
+// header didn't arrive or didn't carry both
+bool receiveHeader(int connection, uint32_t &length, int (&fds)[PASSED_FDS]) {
+  unsigned char header[4];
+  iovec data{header, sizeof(header)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+  msghdr message{};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  ssize_t received;
+  do {
+    received = recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+  } while (received < 0 && errno == EINTR);
+  if (received <= 0) {
+    return false;
+  }
+
+  auto *fdMessage = CMSG_FIRSTHDR(&message);
+  if (fdMessage == nullptr || fdMessage->cmsg_level != SOL_SOCKET ||
+      fdMessage->cmsg_type != SCM_RIGHTS) {
+    return false;
+  }
+  // a client sending fewer is broken; more would be truncated by the kernel
+  if (fdMessage->cmsg_len != CMSG_LEN(sizeof(fds))) {
+    auto count = (fdMessage->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    int *sent = reinterpret_cast<int *>(CMSG_DATA(fdMessage));
+    for (std::size_t i = 0; i < count; i++) {
+      close(sent[i]);
+    }
+    return false;
+  }
+  std::memcpy(fds, CMSG_DATA(fdMessage), sizeof(fds));
+
+  auto rest = reinterpret_cast<char *>(header) + received;
+  if (!lox::readFully(connection, rest,
+                      sizeof(header) - static_cast<std::size_t>(received))) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  length = lox::decodeLength(header);
+  return true;
+}
+
+} // namespace
+
+Zygote::Zygote(const GcConfig &gcConfig)
+    : errors(compileErrors.rdbuf()), vm(std::cout, errors) {
+  vm.configureGc(gcConfig);
+}
+
+bool Zygote::listen(const std::string &path) {
+  int listener = listenOnSocket(path);
+  if (listener < 0) {
+    return false;
+  }
+  // children are never waited for; this has the kernel reap them
+  std::signal(SIGCHLD, SIG_IGN);
+
+  for (;;) {
+    int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (connection < 0) {
+      continue;
+    }
+    // requests are handled one at a time, so a client that stalls mid-request
+    // can't be allowed to hold up everyone else
+    timeval timeout{REQUEST_TIMEOUT_SECONDS, 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    handle(connection);
+    close(connection);
+  }
+}
+
+// runs in the parent, one connection at a time; the parent stays single
+// threaded so forking it is safe
+void Zygote::handle(int connection) {
+  uint32_t length = 0;
+  int fds[PASSED_FDS];
+  if (!receiveHeader(connection, length, fds)) {
+    return;
+  }
+
+  if (length <= MAX_SCRIPT_PATH) {
+    std::string path(length, '\0');
+    if (readFully(connection, path.data(), length)) {
+      spawn(connection, fds[0], fds[1], path);
+    }
+  }
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void Zygote::spawn(int connection, int outFd, int errFd,
+                   const std::string &path) {
+  auto source = readSource(path);
+  auto script = cache.find(source);
+  if (!script) {
+    compileErrors.str("");
+    if (vm.load(source) == InterpretResult::OK) {
+      script = std::make_shared<const CompiledScript>(vm.exportScript());
+      cache.insert(source, script);
+    }
+    vm.reset();
+  }
+
+  // nothing buffered may be written twice
+  std::cout.flush();
+  auto child = fork();
+  if (child == 0) {
+    runChild(connection, outFd, errFd, script.get());
+  }
+  if (child < 0) {
+    auto message = std::string("Can't fork: ") + std::strerror(errno) + "\n";
+    writeFully(errFd, message.data(), message.size());
+    uint8_t status = 71; // EX_OSERR
+    writeFully(connection, reinterpret_cast<char *>(&status), 1);
+  }
+}
+
+// script is nullptr if it didn't compile, and compileErrors says why
+void Zygote::runChild(int connection, int outFd, int errFd,
+                      const CompiledScript *script) {
+  // behave like a process started from the shell
+  std::signal(SIGPIPE, SIG_DFL);
+  std::signal(SIGCHLD, SIG_DFL);
+
+  dup2(outFd, 1);
+  dup2(errFd, 2);
+  auto errorText = compileErrors.str();
+  errors.rdbuf(std::cerr.rdbuf());
+
+  InterpretResult result = InterpretResult::COMPILE_ERROR;
+  if (script == nullptr) {
+    errors << errorText;
+  } else if ((result = vm.load(*script)) == InterpretResult::OK) {
+    result = vm.resume();
+  }
+  std::cout.flush();
+  std::cerr.flush();
+
+  uint8_t status = exitStatus(result);
+  writeFully(connection, reinterpret_cast<char *>(&status), 1);
+  // skips the parent's exit handlers and destructors
+  _exit(status);
+}
+
+int lox::runInZygote(const std::string &socketPath, const std::string &path) {
+  sockaddr_un address{};
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path too long: " << socketPath << "\n";
+    return 74;
+  }
+  address.sun_family = AF_UNIX;
+  std::strcpy(address.sun_path, socketPath.c_str());
+
+  int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (connection < 0 ||
+      connect(connection, reinterpret_cast<sockaddr *>(&address),
+              sizeof(address)) < 0) {
+    std::cerr << "Can't connect to " << socketPath << ": "
+              << std::strerror(errno) << "\n";
+    return 74;
+  }
+
+  // the zygote has its own working directory
+  auto absolutePath = path;
+  if (path.empty() || path[0] != '/') {
+    std::unique_ptr<char, decltype(&free)> cwd(getcwd(nullptr, 0), &free);
+    if (cwd) {
+      absolutePath = std::string(cwd.get()) + "/" + path;
+    }
+  }
+
+  std::string frame;
+  appendLength(frame, static_cast<uint32_t>(absolutePath.size()));
+  frame += absolutePath;
+
+  int fds[PASSED_FDS] = {1, 2};
+  iovec data{frame.data(), frame.size()};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+  msghdr message{};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  auto *fdMessage = CMSG_FIRSTHDR(&message);
+  fdMessage->cmsg_level = SOL_SOCKET;
+  fdMessage->cmsg_type = SCM_RIGHTS;
+  fdMessage->cmsg_len = CMSG_LEN(sizeof(fds));
+  std::memcpy(CMSG_DATA(fdMessage), fds, sizeof(fds));
+
+  ssize_t sent;
+  do {
+    sent = sendmsg(connection, &message, MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+  if (sent < 0 ||
+      !writeFully(connection, frame.data() + sent,
+                  frame.size() - static_cast<std::size_t>(sent))) {
+    std::cerr << "Can't send request to " << socketPath << "\n";
+    return 74;
+  }
+
+  char status = 0;
+  if (!readFully(connection, &status, 1)) {
+    std::cerr << "Zygote closed the connection without a status.\n";
+    return 70;
+  }
+  return static_cast<unsigned char>(status);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "memory.hpp"
+#include "script_cache.hpp"
+#include "vm.hpp"
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace lox {
+
+constexpr uint32_t MAX_SCRIPT_PATH = 4096;
+
+// Wire format, over a Unix socket; one request per connection.
+//   request:  4-byte big-endian length, then the script's absolute path;
+//             the client's stdout and stderr are attached as SCM_RIGHTS
+//   response: one status byte, the exit code main would have returned
+// The script's output and errors go straight to the attached descriptors.
+// If the child running it dies, the connection closes with no status.
+
+// A resident, fully initialized interpreter that forks a child per request.
+// Children start as copies of the parent, so they skip process startup and
+// VM and compiler construction, and a script whose source the parent has
+// compiled before runs from cached bytecode. The parent compiles each new
+// script before forking so later requests for it hit the cache.
+class Zygote {
+private:
+  std::ostringstream compileErrors;
+  std::ostream errors; // compileErrors in the parent, stderr in a child
+  VM vm;
+  ScriptCache cache;
+
+  void handle(int connection);
+  // compiles the script at path if it isn't cached, then forks a child to
+  // run it
+  void spawn(int connection, int outFd, int errFd, const std::string &path);
+  [[noreturn]] void runChild(int connection, int outFd, int errFd,
+                             const CompiledScript *script);
+
+public:
+  explicit Zygote(const GcConfig &gcConfig);
+
+  Zygote(const Zygote &) = delete;
+  Zygote &operator=(const Zygote &) = delete;
+
+  // serves every connection to a Unix socket at path; only returns, with
+  // false, if it can't listen there
+  bool listen(const std::string &path);
+};
+
+// runs the script at path in the zygote listening at socketPath, with this
+// process's stdout and stderr; returns the exit code to finish with
+int runInZygote(const std::string &socketPath, const std::string &path);
+
+} // namespace lox
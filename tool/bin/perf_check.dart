@@ -0,0 +1,223 @@
+import 'dart:convert';
+import 'dart:io';
+import 'dart:math' as math;
+
+import 'package:args/args.dart';
+import 'package:path/path.dart' as p;
+
+/// Runs every benchmark a fixed number of times and compares wall time,
+/// executed instruction count and peak RSS against a stored baseline. Exits
+/// with status 1 if anything got significantly worse, or if a benchmark fails
+/// to run without the baseline saying it doesn't run yet.
+
+const _defaultBaseline = "tool/perf_baseline.json";
+const _defaultIterations = 5;
+
+/// A slowdown only counts if the mean time grew by at least this fraction...
+const _minTimeRegression = 0.05;
+
+/// ...and the difference is this many standard errors wide, so run-to-run
+/// noise doesn't fail the check.
+const _significance = 3.0;
+
+/// Instruction counts are deterministic, so they get a tight tolerance.
+const _instructionTolerance = 0.01;
+
+/// Peak RSS has to grow by this fraction and this many kilobytes to count.
+const _rssTolerance = 0.10;
+const _rssSlackKb = 1024;
+
+final _instructionsPattern = RegExp(r"instructions:\s+(\d+)");
+final _peakRssPattern = RegExp(r"peak rss:\s+(\d+) kB");
+
+class Measurement {
+  final List<double> seconds;
+  final int instructions;
+  final int peakRssKb;
+
+  Measurement(this.seconds, this.instructions, this.peakRssKb);
+
+  Measurement.fromJson(Map<String, dynamic> json)
+      : seconds = (json["seconds"] as List)
+            .cast<num>()
+            .map((n) => n.toDouble())
+            .toList(),
+        instructions = json["instructions"] as int,
+        peakRssKb = json["peakRssKb"] as int;
+
+  Map<String, dynamic> toJson() => {
+        "seconds": seconds,
+        "instructions": instructions,
+        "peakRssKb": peakRssKb,
+      };
+
+  double get mean => seconds.reduce((a, b) => a + b) / seconds.length;
+
+  double get variance {
+    if (seconds.length < 2) return 0.0;
+    var m = mean;
+    var sum = seconds.map((s) => (s - m) * (s - m)).reduce((a, b) => a + b);
+    return sum / (seconds.length - 1);
+  }
+}
+
+void main(List<String> arguments) {
+  var parser = ArgParser();
+  parser.addOption("interpreter",
+      abbr: "i", defaultsTo: "build/apps/main", help: "Path to interpreter.");
+  parser.addOption("baseline",
+      defaultsTo: _defaultBaseline, help: "Baseline JSON file.");
+  parser.addOption("iterations",
+      abbr: "n",
+      defaultsTo: "$_defaultIterations",
+      help: "Runs per benchmark.");
+  parser.addFlag("update",
+      negatable: false, help: "Record results as the new baseline.");
+
+  var options = parser.parse(arguments);
+  var interpreter = options["interpreter"] as String;
+  var baselinePath = options["baseline"] as String;
+  var iterations = int.parse(options["iterations"] as String);
+
+  var benchmarks = Directory(p.join("test", "benchmark"))
+      .listSync()
+      .whereType<File>()
+      .map((file) => file.path)
+      .where((path) => p.extension(path) == ".lox")
+      .toList()
+    ..sort();
+
+  // null for benchmarks that don't run successfully
+  var results = <String, Measurement>{};
+  for (var benchmark in benchmarks) {
+    var name = p.basenameWithoutExtension(benchmark);
+    results[name] = _measure(interpreter, benchmark, iterations);
+  }
+
+  if (options["update"] as bool) {
+    // Benchmarks that don't run are recorded as null, which marks them as
+    // expected to fail until the interpreter supports them.
+    var encoder = JsonEncoder.withIndent("  ");
+    File(baselinePath).writeAsStringSync(encoder.convert(
+        results.map((name, result) => MapEntry(name, result?.toJson()))) +
+        "\n");
+    print("Wrote ${results.length} results to $baselinePath.");
+    return;
+  }
+
+  var baseline = _readBaseline(baselinePath);
+  var regressions = 0;
+  for (var name in results.keys) {
+    var result = results[name];
+    var base = baseline[name];
+    if (result == null) {
+      if (base != null) {
+        print("${name.padRight(20)} REGRESSED; ran in the baseline but not now");
+      } else if (baseline.containsKey(name)) {
+        print("${name.padRight(20)} skipped; doesn't run yet");
+        continue;
+      } else {
+        print("${name.padRight(20)} FAILED; doesn't run and has no baseline");
+      }
+      regressions++;
+      continue;
+    }
+
+    if (base == null) {
+      print("${name.padRight(20)} ${_seconds(result.mean)}  (no baseline)");
+      continue;
+    }
+
+    var problems = _compare(base, result);
+    var change = 100 * (result.mean / base.mean - 1);
+    var sign = change >= 0 ? "+" : "";
+    print("${name.padRight(20)} ${_seconds(result.mean)}  "
+        "($sign${change.toStringAsFixed(1)}% vs ${_seconds(base.mean)})"
+        "${problems.isEmpty ? "" : "  REGRESSED"}");
+    for (var problem in problems) {
+      print("    $problem");
+    }
+    regressions += problems.length;
+  }
+
+  for (var name in baseline.keys) {
+    if (!results.containsKey(name) && baseline[name] != null) {
+      print("${name.padRight(20)} REGRESSED; in the baseline but missing now");
+      regressions++;
+    }
+  }
+
+  if (regressions > 0) {
+    print("$regressions regression${regressions == 1 ? "" : "s"} found.");
+    exit(1);
+  }
+}
+
+/// Runs [benchmark] [iterations] times, or returns `null` if any run fails.
+Measurement _measure(String interpreter, String benchmark, int iterations) {
+  var seconds = <double>[];
+  var instructions = 0;
+  var peakRssKb = 0;
+
+  for (var i = 0; i < iterations; i++) {
+    var stopwatch = Stopwatch()..start();
+    var result = Process.runSync(interpreter, ["--stats", benchmark]);
+    stopwatch.stop();
+    if (result.exitCode != 0) return null;
+
+    var stats = result.stderr as String;
+    var instructionsMatch = _instructionsPattern.firstMatch(stats);
+    var peakRssMatch = _peakRssPattern.firstMatch(stats);
+    if (instructionsMatch == null || peakRssMatch == null) return null;
+
+    seconds.add(stopwatch.elapsedMicroseconds / 1000000.0);
+    instructions = int.parse(instructionsMatch[1]);
+    peakRssKb = math.max(peakRssKb, int.parse(peakRssMatch[1]));
+  }
+
+  return Measurement(seconds, instructions, peakRssKb);
+}
+
+/// A null entry is a benchmark recorded as not running yet.
+Map<String, Measurement> _readBaseline(String path) {
+  var file = File(path);
+  if (!file.existsSync()) return {};
+
+  var json = jsonDecode(file.readAsStringSync()) as Map<String, dynamic>;
+  return json.map((name, result) => MapEntry(
+      name,
+      result == null
+          ? null
+          : Measurement.fromJson(result as Map<String, dynamic>)));
+}
+
+/// Describes each way [result] is significantly worse than [base].
+List<String> _compare(Measurement base, Measurement result) {
+  var problems = <String>[];
+
+  // Welch's t statistic: the difference in means over its standard error.
+  var difference = result.mean - base.mean;
+  var standardError = math.sqrt(base.variance / base.seconds.length +
+      result.variance / result.seconds.length);
+  var significant = standardError == 0.0
+      ? difference > 0
+      : difference / standardError >= _significance;
+  if (difference > base.mean * _minTimeRegression && significant) {
+    problems
+        .add("wall time ${_seconds(base.mean)} -> ${_seconds(result.mean)}");
+  }
+
+  if (result.instructions > base.instructions * (1 + _instructionTolerance)) {
+    problems
+        .add("instructions ${base.instructions} -> ${result.instructions}");
+  }
+
+  if (result.peakRssKb > base.peakRssKb * (1 + _rssTolerance) &&
+      result.peakRssKb - base.peakRssKb > _rssSlackKb) {
+    problems.add("peak RSS ${base.peakRssKb} kB -> ${result.peakRssKb} kB");
+  }
+
+  return problems;
+}
+
+String _seconds(double seconds) => "${seconds.toStringAsFixed(4)}s";